@@ -0,0 +1,96 @@
+#include "board.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_WIDTH 10000
+#define BENCH_HEIGHT 16
+#define BENCH_CHARGES 20000
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//one ghost per row on a board with walls only at the borders
+static void make_board(board_t *board) {
+    snprintf(board->level_name, sizeof(board->level_name), "bench");
+    board->width = BENCH_WIDTH;
+    board->height = BENCH_HEIGHT;
+    board->board = arena_alloc(&board->arena, BENCH_WIDTH * BENCH_HEIGHT * sizeof(board_pos_t));
+    board->row_agents = NULL;
+    board->dirty = NULL;
+    board->col_agents = NULL;
+    board->n_pacmans = 0;
+    board->pacmans = NULL;
+    board->n_ghosts = BENCH_HEIGHT - 2;
+    board->ghosts = arena_alloc(&board->arena, board->n_ghosts * sizeof(ghost_t));
+    for (int y = 0; y < BENCH_HEIGHT; y++) {
+        for (int x = 0; x < BENCH_WIDTH; x++) {
+            if (x == 0 || y == 0 || x == BENCH_WIDTH - 1 || y == BENCH_HEIGHT - 1)
+                board_set_content(board, y * BENCH_WIDTH + x, 'W');
+        }
+    }
+    for (int g = 0; g < board->n_ghosts; g++) {
+        board->ghosts[g].pos_x = 1;
+        board->ghosts[g].pos_y = g + 1;
+        board_set_content(board, (g + 1) * BENCH_WIDTH + 1, 'M');
+    }
+    build_level_tables(board);
+}
+
+//the cell by cell walk the bitmaps replace, kept here as the baseline
+static void walk_charge(board_t *board, ghost_t *ghost, int step) {
+    int x = ghost->pos_x;
+    int y = ghost->pos_y;
+    int j = x + step;
+    while (j >= 0 && j < board->width) {
+        char c = board_content(board, y * board->width + j);
+        if (c == 'W' || c == 'M') break;
+        j += step;
+    }
+    board_set_content(board, y * board->width + x, ' ');
+    ghost->pos_x = j - step;
+    board_set_content(board, y * board->width + ghost->pos_x, 'M');
+}
+
+int main() {
+    open_debug_file("/dev/null");
+    board_t board;
+    arena_init(&board.arena, ARENA_BLOCK_SIZE);
+    make_board(&board);
+    command_t right = {'D', 1, 1};
+    command_t left = {'A', 1, 1};
+
+    double start = now_sec();
+    for (int i = 0; i < BENCH_CHARGES; i++) {
+        int g = i % board.n_ghosts;
+        walk_charge(&board, &board.ghosts[g], ((i / board.n_ghosts) % 2 == 0) ? 1 : -1);
+    }
+    double walk = now_sec() - start;
+    int walk_x = board.ghosts[0].pos_x;
+    unload_level(&board);
+
+    make_board(&board);
+    start = now_sec();
+    for (int i = 0; i < BENCH_CHARGES; i++) {
+        int g = i % board.n_ghosts;
+        board.ghosts[g].charged = 1;
+        move_ghost(&board, g, ((i / board.n_ghosts) % 2 == 0) ? &right : &left);
+    }
+    double bitmaps = now_sec() - start;
+    int bitmaps_x = board.ghosts[0].pos_x;
+    unload_level(&board);
+    arena_release(&board.arena);
+    close_debug_file();
+
+    printf("charge on %d-wide rows, %d charges\n", BENCH_WIDTH, BENCH_CHARGES);
+    printf("  cell walk: %10.1f ns/charge\n", walk * 1e9 / BENCH_CHARGES);
+    printf("  bitmaps:   %10.1f ns/charge (%.0fx)\n", bitmaps * 1e9 / BENCH_CHARGES, walk / bitmaps);
+    if (walk_x != bitmaps_x) {
+        fprintf(stderr, "mismatch: walk ended at %d, bitmaps at %d\n", walk_x, bitmaps_x);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,385 @@
+#include "board.h"
+#include "frame.h"
+#include "lvlb.h"
+#if BENCH_DRAW
+#include "display.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// every case repeats its operation until it has run for at least this long
+#define BENCH_MIN_SEC 0.25
+
+#define SMALL_WIDTH 20
+#define SMALL_HEIGHT 10
+#define SMALL_GHOSTS 4
+#define BIG_WIDTH 1000
+#define BIG_HEIGHT 1000
+#define BIG_GHOSTS 10000
+
+// a synthetic level written to the bench directory
+typedef struct {
+    const char *name;       // column of the CSV, also the level file name
+    int width, height;
+    int n_ghosts;           // one ghost every few free positions, 0 for a pacman alone
+    const char *ghost_moves; // script of every ghost
+} level_spec_t;
+
+static const level_spec_t levels[] = {
+    {"small", SMALL_WIDTH, SMALL_HEIGHT, 0, "R"},
+    {"small_4_ghosts", SMALL_WIDTH, SMALL_HEIGHT, SMALL_GHOSTS, "R"},
+    {"1kx1k", BIG_WIDTH, BIG_HEIGHT, 0, "R"},
+    {"1kx1k_10k_ghosts", BIG_WIDTH, BIG_HEIGHT, BIG_GHOSTS, "R"},
+    {"1kx1k_10k_charged", BIG_WIDTH, BIG_HEIGHT, BIG_GHOSTS, "C\nR"},
+};
+#define N_LEVELS ((int)(sizeof(levels) / sizeof(levels[0])))
+
+static char bench_dir[] = "/tmp/pacbench.XXXXXX";
+static FILE *csv;
+static const char *label;
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static FILE *open_in_dir(const char *name) {
+    char path[2 * MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/%s", bench_dir, name);
+    FILE *file = fopen(path, "w");
+    if (file == NULL) perror(path);
+    return file;
+}
+
+//a walled board full of dots, the pacman in the first free position and the ghosts spread over the rest
+static int write_level(const level_spec_t *spec) {
+    char name[MAX_FILENAME];
+    snprintf(name, sizeof(name), "%s.p", spec->name);
+    FILE *file = open_in_dir(name);
+    if (file == NULL) return -1;
+    fprintf(file, "PASSO 0\nPOS 1 1\nR\n");
+    fclose(file);
+
+    int free_cells = (spec->width - 2) * (spec->height - 2) - 1;
+    int spacing = spec->n_ghosts > 0 ? free_cells / spec->n_ghosts : 1;
+    for (int g = 0; g < spec->n_ghosts; g++) {
+        int cell = 1 + g * spacing;
+        snprintf(name, sizeof(name), "%s_%d.m", spec->name, g);
+        file = open_in_dir(name);
+        if (file == NULL) return -1;
+        fprintf(file, "PASSO 0\nPOS %d %d\n%s\n", 1 + cell % (spec->width - 2), 1 + cell / (spec->width - 2), spec->ghost_moves);
+        fclose(file);
+    }
+
+    snprintf(name, sizeof(name), "%s.lvl", spec->name);
+    file = open_in_dir(name);
+    if (file == NULL) return -1;
+    fprintf(file, "DIM %d %d\nTEMPO 0\nPAC %s.p\n", spec->width, spec->height, spec->name);
+    if (spec->n_ghosts > 0) {
+        fprintf(file, "MON");
+        for (int g = 0; g < spec->n_ghosts; g++) fprintf(file, " %s_%d.m", spec->name, g);
+        fprintf(file, "\n");
+    }
+    for (int y = 0; y < spec->height; y++) {
+        for (int x = 0; x < spec->width; x++) {
+            fputc(x == 0 || y == 0 || x == spec->width - 1 || y == spec->height - 1 ? 'X' : 'o', file);
+        }
+        fputc('\n', file);
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static void remove_levels() {
+    char path[3 * MAX_FILENAME];
+    for (int l = 0; l < N_LEVELS; l++) {
+        const char *suffixes[] = {".p", ".lvl", LVLB_EXTENSION};
+        for (int s = 0; s < 3; s++) {
+            snprintf(path, sizeof(path), "%s/%s%s", bench_dir, levels[l].name, suffixes[s]);
+            unlink(path);
+        }
+        for (int g = 0; g < levels[l].n_ghosts; g++) {
+            snprintf(path, sizeof(path), "%s/%s_%d.m", bench_dir, levels[l].name, g);
+            unlink(path);
+        }
+    }
+    rmdir(bench_dir);
+}
+
+static int load_file(board_t *board, const char *name, const char *suffix) {
+    char path[3 * MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/%s%s", bench_dir, name, suffix);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    snprintf(board->level_name, sizeof(board->level_name), "%s%s", name, suffix);
+    board->seed = 1;
+    int loaded = load_level(board, 0, fd, bench_dir);
+    close(fd);
+    if (loaded == -1) {
+        fprintf(stderr, "bench: could not load %s\n", path);
+        unload_level(board);
+    }
+    return loaded;
+}
+
+static int compile_level(board_t *board, const char *name) {
+    if (load_file(board, name, ".lvl") == -1) return -1;
+    char path[3 * MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/%s%s", bench_dir, name, LVLB_EXTENSION);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = fd < 0 ? -1 : lvlb_write(board, fd);
+    if (fd >= 0) close(fd);
+    unload_level(board);
+    return result;
+}
+
+static void report(const char *bench, const char *level, long ops, double seconds) {
+    printf("  %-12s %-18s %12.1f ns/op %14.0f ops/s\n", bench, level, seconds * 1e9 / ops, ops / seconds);
+    fprintf(csv, "%s,%s,%s,%ld,%.6f,%.1f,%.0f\n", label, bench, level, ops, seconds, seconds * 1e9 / ops, ops / seconds);
+}
+
+//parse and build the tables of a level, then drop it
+static int bench_load(board_t *board, const char *level, const char *suffix, const char *bench) {
+    long ops = 0;
+    double start = now_sec(), elapsed;
+    do {
+        if (load_file(board, level, suffix) == -1) return -1;
+        unload_level(board);
+        ops++;
+    } while ((elapsed = now_sec() - start) < BENCH_MIN_SEC);
+    report(bench, level, ops, elapsed);
+    return 0;
+}
+
+//what renderer_publish does with the dirty positions once a tick is over
+static void clear_dirty(board_t *board) {
+    if (board->full_redraw) {
+        for (int index = 0; index < board->width * board->height; index++) {
+            board->board[index] &= ~CELL_DIRTY;
+        }
+        board->full_redraw = 0;
+    }
+    for (int i = 0; i < board->n_dirty; i++) {
+        board->board[board->dirty[i]] &= ~CELL_DIRTY;
+    }
+    board->n_dirty = 0;
+}
+
+//one ghost tick moves every ghost once, the way the ghost clock without workers does
+static void ghost_tick(board_t *board) {
+    for (int g = 0; g < board->n_ghosts; g++) {
+        ghost_t *ghost = &board->ghosts[g];
+        move_ghost(board, g, &ghost->moves[ghost->current_move % ghost->n_moves]);
+    }
+}
+
+//one pacman tick is a move along its script, a pacman alone never dies
+static void bench_pacman(board_t *board, const char *level) {
+    pacman_t *pac = &board->pacmans[0];
+    long ops = 0;
+    double start = now_sec(), elapsed;
+    do {
+        for (int i = 0; i < 1024; i++) {
+            move_pacman(board, 0, &pac->moves[pac->current_move++ % pac->n_moves]);
+        }
+        ops += 1024;
+        clear_dirty(board);
+    } while ((elapsed = now_sec() - start) < BENCH_MIN_SEC);
+    report("pacman_tick", level, ops, elapsed);
+}
+
+static void bench_ghosts(board_t *board, const char *bench, const char *level) {
+    long ops = 0;
+    double start = now_sec(), elapsed;
+    do {
+        ghost_tick(board);
+        ops++;
+        clear_dirty(board);
+    } while ((elapsed = now_sec() - start) < BENCH_MIN_SEC);
+    report(bench, level, ops, elapsed);
+}
+
+//what draw_frame does with a frame once it is drawn, without a terminal
+static void null_sink(frame_t *frame) {
+    frame->full_redraw = 0;
+    frame->n_changed = 0;
+}
+
+//frame_publish and frame_take the way renderer_publish and the render thread call them, into a sink,
+//the whole board every op, then the positions one ghost tick changes
+static int bench_publish(board_t *board, const char *level) {
+    frame_t published, shown;
+    frame_init(&published);
+    frame_init(&shown);
+    int result = 0;
+    long ops = 0;
+    double start = now_sec(), elapsed;
+    do {
+        board->full_redraw = 1;
+        if (frame_publish(&published, board, DRAW_MENU) == -1 || frame_take(&shown, &published) == -1) {
+            result = -1;
+            break;
+        }
+        null_sink(&shown);
+        ops++;
+    } while ((elapsed = now_sec() - start) < BENCH_MIN_SEC);
+    if (result == 0) report("publish_full", level, ops, elapsed);
+
+    if (result == 0 && board->n_ghosts > 0) {
+        ops = 0;
+        double ticks = 0;
+        do {
+            ghost_tick(board);
+            //only the publish is timed, not the tick that dirtied the positions
+            start = now_sec();
+            if (frame_publish(&published, board, DRAW_MENU) == -1 || frame_take(&shown, &published) == -1) {
+                result = -1;
+                break;
+            }
+            null_sink(&shown);
+            ticks += now_sec() - start;
+            ops++;
+        } while (ticks < BENCH_MIN_SEC);
+        if (result == 0) report("publish_tick", level, ops, ticks);
+    }
+    if (result == -1) fprintf(stderr, "bench: out of memory\n");
+    frame_free(&published);
+    frame_free(&shown);
+    return result;
+}
+
+#if BENCH_DRAW
+//draw_frame and refresh_screen against a terminal sized to the board that writes to /dev/null,
+//a full redraw every op, then the positions one ghost tick changes
+static int bench_draw(board_t *board, const char *level) {
+    frame_t published, shown;
+    frame_init(&published);
+    frame_init(&shown);
+    board->full_redraw = 1;
+    if (frame_publish(&published, board, DRAW_MENU) == -1 || frame_take(&shown, &published) == -1) {
+        fprintf(stderr, "bench: out of memory\n");
+        frame_free(&published);
+        frame_free(&shown);
+        return -1;
+    }
+    resizeterm(board->height + 5, board->width > 80 ? board->width : 80);
+    long ops = 0;
+    double start = now_sec(), elapsed;
+    do {
+        shown.full_redraw = 1;
+        draw_frame(&shown);
+        refresh_screen();
+        ops++;
+    } while ((elapsed = now_sec() - start) < BENCH_MIN_SEC);
+    report("draw_full", level, ops, elapsed);
+
+    int result = 0;
+    if (board->n_ghosts > 0) {
+        ops = 0;
+        double ticks = 0;
+        do {
+            ghost_tick(board);
+            if (frame_publish(&published, board, DRAW_MENU) == -1 || frame_take(&shown, &published) == -1) {
+                fprintf(stderr, "bench: out of memory\n");
+                result = -1;
+                break;
+            }
+            //only the draw is timed, not the tick and the publish that got the positions to it
+            start = now_sec();
+            draw_frame(&shown);
+            refresh_screen();
+            ticks += now_sec() - start;
+            ops++;
+        } while (ticks < BENCH_MIN_SEC);
+        if (result == 0) report("draw_tick", level, ops, ticks);
+    }
+    frame_free(&published);
+    frame_free(&shown);
+    return result;
+}
+
+//the ncurses screen of the draw cases, nothing reaches a terminal
+static SCREEN *open_null_screen() {
+    FILE *out = fopen("/dev/null", "w");
+    FILE *in = fopen("/dev/null", "r");
+    SCREEN *screen = out != NULL && in != NULL ? newterm("xterm", out, in) : NULL;
+    if (screen == NULL) {
+        fprintf(stderr, "bench: no null screen\n");
+        return NULL;
+    }
+    start_color();
+    for (int i = 1; i <= 7; i++) init_pair(i, i, COLOR_BLACK);
+    return screen;
+}
+#endif
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <csv_file> [label]\n", argv[0]);
+        return 1;
+    }
+    label = argc == 3 ? argv[2] : "-";
+    //rows are appended so every version benched lands in the same file
+    csv = fopen(argv[1], "a");
+    if (csv == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (ftell(csv) == 0) fprintf(csv, "label,bench,level,ops,seconds,ns_per_op,ops_per_sec\n");
+    if (mkdtemp(bench_dir) == NULL) {
+        perror(bench_dir);
+        return 1;
+    }
+    open_debug_file("/dev/null");
+#if BENCH_DRAW
+    SCREEN *screen = open_null_screen();
+    if (screen == NULL) return 1;
+#endif
+
+    board_t board;
+    arena_init(&board.arena, ARENA_BLOCK_SIZE);
+    pthread_mutex_init(&board.lock, NULL);
+    int result = 0;
+    printf("engine bench, rows appended to %s\n", argv[1]);
+    for (int l = 0; l < N_LEVELS && result == 0; l++) {
+        const char *level = levels[l].name;
+        result = write_level(&levels[l]);
+        if (result == 0) result = compile_level(&board, level);
+        if (result == 0) result = bench_load(&board, level, ".lvl", "load_text");
+        if (result == 0) result = bench_load(&board, level, LVLB_EXTENSION, "load_lvlb");
+        if (result == 0) result = load_file(&board, level, ".lvl");
+        if (result != 0) break;
+
+        if (board.n_ghosts == 0) {
+            bench_pacman(&board, level);
+        } else {
+            bench_ghosts(&board, strchr(levels[l].ghost_moves, 'C') ? "charge_tick" : "ghost_tick", level);
+        }
+        result = bench_publish(&board, level);
+#if BENCH_DRAW
+        if (result == 0) result = bench_draw(&board, level);
+#endif
+        unload_level(&board);
+    }
+
+#if BENCH_DRAW
+    endwin();
+    delscreen(screen);
+#endif
+    remove_levels();
+    pthread_mutex_destroy(&board.lock);
+    arena_release(&board.arena);
+    close_debug_file();
+    if (fclose(csv) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// default size of an arena block, bigger requests get a block of their own
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct arena_block {
+    struct arena_block *next;   // older block
+    size_t size;                // bytes usable after the header
+    size_t used;
+} arena_block_t;
+
+// bump allocator, everything allocated from it is released together
+typedef struct {
+    arena_block_t *head;        // block currently being filled
+    size_t block_size;
+    size_t allocs;              // arena_alloc calls since the last reset
+    size_t bytes;               // bytes handed out since the last reset, with alignment padding
+    size_t reserved;            // bytes held in blocks
+} arena_t;
+
+/*Initializes an empty arena, no memory is allocated until the first arena_alloc*/
+void arena_init(arena_t *arena, size_t block_size);
+
+/*Returns 'size' zeroed bytes aligned for any type, or NULL if out of memory*/
+void *arena_alloc(arena_t *arena, size_t size);
+
+/*Copies a string into the arena*/
+char *arena_strdup(arena_t *arena, const char *str);
+
+/*Releases everything allocated so far in one go, keeps one block to be reused*/
+void arena_reset(arena_t *arena);
+
+/*Releases every block*/
+void arena_release(arena_t *arena);
+
+#endif
@@ -2,11 +2,17 @@
 #define BOARD_H
 
 #include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "rng.h"
+#include "arena.h"
+#include "tick.h"
+#include "log.h"
+#include "stats.h"
+#include "tracer.h"
 
-#define MAX_MOVES 20
 #define MAX_LEVELS 20
 #define MAX_FILENAME 256
-#define MAX_GHOSTS 25
 
 typedef enum {
     REACHED_PORTAL = 1,
@@ -26,27 +32,59 @@ typedef struct {
     int alive; // if is alive
     int points; // how many points have been collected
     int passo; // number of plays to wait before starting
-    command_t moves[MAX_MOVES];
+    command_t* moves; // script read from the level file, in the level arena
     int current_move;
     int n_moves; // number of predefined moves, 0 if controlled by user, >0 if readed from level file
     int waiting;
+    rng_t rng; // own random stream for 'R' moves
 } pacman_t;
 
 typedef struct {
     int pos_x, pos_y; //current position
     int passo; // number of plays to wait between each move
-    command_t moves[MAX_MOVES];
+    command_t* moves; // script read from the level file, in the level arena
     int n_moves; // number of predefined moves from level file
     int current_move;
     int waiting;
     int charged;
+    rng_t rng; // own random stream for 'R' moves
 } ghost_t;
 
+// what a ghost decided to do in a tick, see plan_ghost
 typedef struct {
-    char content;   // stuff like 'P' for pacman 'M' for monster/ghost and 'W' for wall
-    int has_dot;    // whether there is a dot in this position or not
-    int has_portal; // whether there is a portal in this position or not
-} board_pos_t;
+    char direction; // 'W', 'A', 'S' or 'D' when the ghost moves, '\0' when it only updated itself
+    int charged;    // whether the move is a charge, or with no direction whether the ghost just charged
+    int result;     // move result when there is nothing to apply
+} ghost_intent_t;
+
+// a board position packed in one byte:
+// bits 0-1 content (empty, 'W' wall, 'P' pacman, 'M' monster/ghost), bit 2 dot, bit 3 portal,
+// bit 4 dirty (changed since the last draw, already in board_t.dirty)
+typedef uint8_t board_pos_t;
+
+#define CELL_CONTENT_MASK 0x03
+#define CELL_EMPTY 0x00
+#define CELL_WALL 0x01
+#define CELL_PACMAN 0x02
+#define CELL_GHOST 0x03
+#define CELL_DOT 0x04
+#define CELL_PORTAL 0x08
+#define CELL_DIRTY 0x10
+
+// positions the dirty list holds at least, a level gets more when it has many agents
+#define DIRTY_MIN 1024
+
+// ids kept in the agent index, ghosts use their own index
+#define NO_AGENT -1
+#define PACMAN_AGENT(index) (-2 - (index))
+#define AGENT_IS_PACMAN(agent) ((agent) <= -2)
+#define AGENT_PACMAN_INDEX(agent) (-2 - (agent))
+
+// one entry of the agent index, position is -1 in a free slot
+typedef struct {
+    int position;
+    int agent;
+} agent_slot_t;
 
 typedef struct {
     int width, height;      // dimensions of the board
@@ -57,13 +95,119 @@ typedef struct {
     ghost_t* ghosts;        // array containing every ghost in the board to iterate through when processing
     char level_name[256];   //name for the level file to keep track of which will be the next
     char pacman_file[256];  // file with pacman movements
-    char ghosts_files[MAX_GHOSTS][256]; // files with monster movements
+    char** ghosts_files;    // files with monster movements, one per ghost
     int tempo;              // Duration of each play
+    tick_timeline_t timeline; // deadlines of the plays, shared by the pacman loop and the ghost clock
+    uint64_t seed;          // seed of this level, every agent gets its own stream of it
     int on_save; //1 if its on save, 0 if it is not
-    int threads_live; //1 if threads are on, 0 if they are off
+    atomic_int threads_live; //1 while the ghosts should keep moving, 0 to stop them
     pthread_mutex_t lock;
+    uint64_t *row_walls;    // bitmap of positions holding 'W', row_words words per board row
+    uint64_t *col_walls;    // the same bitmap transposed, col_words words per board column
+    uint64_t *row_agents;   // bitmap of positions holding 'P' or 'M', laid out as row_walls
+    uint64_t *col_agents;   // the same bitmap transposed, laid out as col_walls
+    int row_words, col_words;
+    agent_slot_t *agents;   // agent on each occupied position, open addressing sized from the agents, not the board
+    int agents_mask;        // slots - 1, at least twice as many slots as agents
+    int *dirty;             // positions changed since the last draw, each one once, in the level arena
+    int n_dirty;
+    int dirty_capacity;     // a few per agent, more changes than this fall back to full_redraw
+    int full_redraw;        // 1 when the whole screen must be drawn again, after a load or a restore
+    arena_t arena;          // every allocation of the loaded level, reset by unload_level
 } board_t;
 
+/*Sets or clears the agent bit of a position in the per-row and per-column bitmaps*/
+void board_mark_agent(board_t* board, int index, int present);
+
+/*Agent on a position: ghost index, PACMAN_AGENT(index) or NO_AGENT*/
+int board_agent_at(const board_t* board, int index);
+
+/*Records the agent now on a position, NO_AGENT when it left*/
+void board_set_agent(board_t* board, int index, int agent);
+
+/*Takes board->lock, with STATS the wait is timed, a free lock counts as 0
+With --trace a contended wait and every hold are slices of the calling thread.
+Without either it is a plain pthread_mutex_lock, the free lock is only tried first when something measures it*/
+static inline void board_lock(board_t* board) {
+#if STATS
+    if (pthread_mutex_trylock(&board->lock) == 0) {
+        stats_add(STAT_LOCK_WAIT, 0);
+    } else {
+        trace_begin("lock wait");
+        stats_start(start);
+        pthread_mutex_lock(&board->lock);
+        stats_stop(STAT_LOCK_WAIT, start);
+        trace_end("lock wait");
+    }
+#else
+    if (!tracer_enabled) {
+        pthread_mutex_lock(&board->lock);
+    } else if (pthread_mutex_trylock(&board->lock) != 0) {
+        trace_begin("lock wait");
+        pthread_mutex_lock(&board->lock);
+        trace_end("lock wait");
+    }
+#endif
+    trace_begin("board lock");
+}
+
+static inline void board_unlock(board_t* board) {
+    trace_end("board lock");
+    pthread_mutex_unlock(&board->lock);
+}
+
+/*Queues a position to be drawn again, called by every setter below*/
+static inline void board_mark_dirty(board_t* board, int index) {
+    if (!(board->board[index] & CELL_DIRTY)) {
+        board->board[index] |= CELL_DIRTY;
+        if (!board->dirty) return; // no list yet while loading
+        if (board->n_dirty < board->dirty_capacity) board->dirty[board->n_dirty++] = index;
+        else board->full_redraw = 1; // too many to list, the next draw repaints everything
+    }
+}
+
+/*Board accessors, every read or write of a position goes through these
+content is one of ' ', 'W', 'P' or 'M'*/
+static inline char board_content(const board_t* board, int index) {
+    return " WPM"[board->board[index] & CELL_CONTENT_MASK];
+}
+
+static inline void board_set_content(board_t* board, int index, char content) {
+    board_pos_t bits;
+    switch (content) {
+        case 'W': bits = CELL_WALL; break;
+        case 'P': bits = CELL_PACMAN; break;
+        case 'M': bits = CELL_GHOST; break;
+        default: bits = CELL_EMPTY; break;
+    }
+    board_pos_t old = board->board[index] & CELL_CONTENT_MASK;
+    board->board[index] = (board->board[index] & ~CELL_CONTENT_MASK) | bits;
+    board_mark_dirty(board, index);
+    if ((old >= CELL_PACMAN) != (bits >= CELL_PACMAN)) {
+        board_mark_agent(board, index, bits >= CELL_PACMAN);
+    }
+}
+
+static inline int board_has_dot(const board_t* board, int index) {
+    return (board->board[index] & CELL_DOT) != 0;
+}
+
+static inline void board_set_dot(board_t* board, int index, int has_dot) {
+    if (has_dot) board->board[index] |= CELL_DOT;
+    else board->board[index] &= ~CELL_DOT;
+    board_mark_dirty(board, index);
+}
+
+static inline int board_has_portal(const board_t* board, int index) {
+    return (board->board[index] & CELL_PORTAL) != 0;
+}
+
+static inline void board_set_portal(board_t* board, int index, int has_portal) {
+    if (has_portal) board->board[index] |= CELL_PORTAL;
+    else board->board[index] &= ~CELL_PORTAL;
+    board_mark_dirty(board, index);
+}
+
 /*Makes the current thread sleep for 'int milliseconds' miliseconds*/
 void sleep_ms(int milliseconds);
 
@@ -73,33 +217,45 @@ command - command to be processed*/
 int move_pacman(board_t* board, int pacman_index, command_t* command);
 int move_ghost(board_t* board, int ghost_index, command_t* command);
 
+/*Two-phase ghost move, move_ghost is plan_ghost followed by apply_ghost
+plan_ghost only touches the ghost itself (script, passo, charge) and can run without board->lock
+apply_ghost changes the board and must run under board->lock*/
+void plan_ghost(board_t* board, int ghost_index, command_t* command, ghost_intent_t* intent);
+int apply_ghost(board_t* board, int ghost_index, ghost_intent_t* intent);
+
+/*Plans the current command of ghosts first, first + stride, ... into intents*/
+void plan_ghosts(board_t* board, ghost_intent_t* intents, int first, int stride);
+
+/*Applies every planned intent in ghost index order, the lower index wins a contested position
+Returns DEAD_PACMAN if a ghost killed the pacman*/
+int resolve_ghosts(board_t* board, ghost_intent_t* intents);
+
 /*Process the death of a Pacman*/
 void kill_pacman(board_t* board, int pacman_index);
 
-/*Adds a pacman to the board*/
+/*Adds a pacman to the board, returns -1 if the file is malformed*/
 int load_pacman(board_t* board, int fd, int points);
 
-/*Adds a ghost(monster) to the board*/
+/*Adds a ghost(monster) to the board, returns -1 if the file is malformed*/
 int load_ghost(board_t* board, int fd, int ghost_index);
 
-/*Loads a level into board*/
+/*Loads a level into board, returns -1 if a file is missing or malformed
+board->seed must be set and board->arena initialized before*/
 int load_level(board_t* board, int accumulated_points, int fd, char *path);
 
-/*Unloads levels loaded by load_level*/
-void unload_level(board_t * board);
-
-// DEBUG FILE
+/*Builds the wall and agent bitmaps and the agent index in the level arena once the board is read,
+called by load_level, returns -1 if out of memory*/
+int build_level_tables(board_t* board);
 
-/*Opens the debug file*/
-void open_debug_file(char *filename);
+/*Refills the agent bitmaps and agent index from the board and the agent positions, the wall bitmaps are kept, the next draw repaints the whole board*/
+void board_index_agents(board_t* board);
 
-/*Closes the debug file*/
-void close_debug_file();
+/*Unloads levels loaded by load_level*/
+void unload_level(board_t * board);
 
-/*Writes to the open debug file*/
-void debug(const char * format, ...);
+// DEBUG FILE, see log.h
 
-/*Writes the board and its contents to the open debug file*/
+/*Writes the board and its contents to the open debug file, as a binary copy the log writer formats*/
 void print_board(board_t* board);
 
 #endif
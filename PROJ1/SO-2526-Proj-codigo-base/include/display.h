@@ -2,13 +2,10 @@
 #define DISPLAY_H
 
 #include "board.h"
+#include "frame.h"
 #include <ncurses.h>
 
 
-#define DRAW_GAME_OVER 0
-#define DRAW_WIN 1
-#define DRAW_MENU 2
-
 
 /*
 Potential Structures for ncurses
@@ -17,8 +14,8 @@ Potential Structures for ncurses
 /*Initialize everything ncurses requires*/
 int terminal_init();
 
-/*Draw the board on the screen*/
-void draw_board(board_t* board, int mode);
+/*Draw a frame on the screen, only the positions in frame->changed unless frame->full_redraw is set*/
+void draw_frame(frame_t* frame);
 
 /*Add a specific character with colour i into position (pos_x,pos_y) of the creen
 Pre loaded colours:
@@ -38,6 +35,9 @@ void refresh_screen();
 /*Ncurses will be reading the player's inputs*/
 char get_input();
 
+/*Maps a key to its command ('W', 'A', 'S', 'D', 'G' or 'Q'), '\0' for any other key*/
+char key_command(int ch);
+
 void terminal_cleanup();
 
 #endif
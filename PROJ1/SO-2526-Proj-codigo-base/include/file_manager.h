@@ -3,12 +3,54 @@
 
 #include "board.h"
 
-//reads the file and returns the file content
-char *read_file(int fd);
+//contents of an open file, mapped when possible, not NUL terminated
+typedef struct {
+    const char *data;
+    size_t size;
+    void *map;          //mapping to release, NULL when the file was read into the arena
+    size_t map_size;
+} file_view_t;
 
-//checks if the file is a level file
+//reads the whole file into the arena, NUL terminated, size_hint is the expected size or 0, returns NULL on error
+char *read_file(int fd, arena_t *arena, size_t size_hint, size_t *size);
+
+//maps a regular file read only, anything else is read into the arena, returns -1 on error
+int open_view(int fd, arena_t *arena, file_view_t *view);
+
+//releases the mapping, nothing read from the view may be used after this
+void close_view(file_view_t *view);
+
+//gives the next line of the view without its newline, returns 0 at the end
+int view_next_line(const file_view_t *view, size_t *cursor, const char **line, size_t *len);
+
+//number of lines in the view, an upper bound for the moves of a script
+int view_count_lines(const file_view_t *view);
+
+//NUL terminated copy of a line, in small when it fits, otherwise in the arena
+char *line_cstr(arena_t *arena, char *small, size_t cap, const char *line, size_t len);
+
+//bounds checked reader over a binary view, error sticks once anything is out of range
+typedef struct {
+    const file_view_t *view;
+    size_t off;
+    int error;
+} view_reader_t;
+
+//returns the next size bytes of the view, or NULL and sets error if there are not enough
+const void *view_take(view_reader_t *r, size_t size);
+
+//returns the next native int32_t of the view, 0 and sets error if there is none
+int32_t view_take_i32(view_reader_t *r);
+
+//checks if a line starts with prefix
+int line_has_prefix(const char *line, size_t len, const char *prefix);
+
+//checks if the file is a level file, text (.lvl) or compiled (.lvlb)
 int is_lvl_file(char *file);
 
+//checks if the file is a compiled level (.lvlb), the game and lvlc tell the two kinds apart with it
+int is_lvlb_file(const char *file);
+
 //frees the level files
 void free_lvl_files(char **lvl_files, int n);
 
@@ -18,26 +60,26 @@ int lvl_comparator(const void *a, const void *b);
 //returns an array of all level files in a directory
 char **get_lvl_files(char *inputdir, int *count);
 
-//sets up board dim
-void set_board_dim(char *dim, board_t *board);
+//sets up board dim, returns -1 if invalid
+int set_board_dim(char *dim, board_t *board);
 
-//prepares to call read_pac_file
-void prepare_and_read_pac_file(board_t *board, char *line, int points, char *path);
+//prepares to call read_pac_file, returns -1 if the file is missing or malformed
+int prepare_and_read_pac_file(board_t *board, char *line, int points, char *path);
 
-//sets memory for ghosts
-void set_memory_for_ghosts(board_t *board, char *mon_files);
+//sets memory for as many ghosts as there are names in mon_files
+int set_memory_for_ghosts(board_t *board, char *mon_files);
 
-//prepares to call read_mon_file
-void prepare_and_read_mon_file(board_t *board, char *mon_files, char *dirpath);
+//prepares to call read_mon_file, returns -1 if a file is missing or malformed
+int prepare_and_read_mon_file(board_t *board, char *mon_files, char *dirpath);
 
-//saves the initialized board
-void store_game_board(board_t *board, char *line, int line_number);
+//saves the initialized board, returns -1 if the line does not fit
+int store_game_board(board_t *board, const char *line, size_t len, int line_number);
 
 //loads pacman for player input
-void load_pacman_for_player(board_t *board, int points);
+int load_pacman_for_player(board_t *board, int points);
 
-//stores inicial pacman position
-void store_pac_pos(board_t *board, char *linePos);
+//stores inicial pacman position, returns -1 if outside the board
+int store_pac_pos(board_t *board, char *linePos);
 
 //stores pacman passo
 void store_pac_passo(board_t *board, char *linePasso);
@@ -45,8 +87,8 @@ void store_pac_passo(board_t *board, char *linePasso);
 //stores pacman moves
 void store_pac_moves(board_t *board, char *command, int move_index);
 
-//stores monster inicial position
-void store_mon_pos(board_t *board, int ghost_index, char *linePos);
+//stores monster inicial position, returns -1 if outside the board
+int store_mon_pos(board_t *board, int ghost_index, char *linePos);
 
 //stores monster passo
 void store_mon_passo(board_t *board, int ghost_index, char *linePasso);
@@ -0,0 +1,45 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "board.h"
+
+#define DRAW_GAME_OVER 0
+#define DRAW_WIN 1
+#define DRAW_MENU 2
+
+// set in frame positions where a charged ghost stands, never in the board itself
+#define FRAME_CHARGED 0x20
+
+// what is drawn on the screen, a copy of the board taken at the end of a tick
+typedef struct {
+    int width, height;
+    board_pos_t *cells;         // board positions without CELL_DIRTY, see FRAME_CHARGED
+    int *changed;               // positions changed since the frame was last drawn, each one once
+    int n_changed;
+    int capacity;               // positions allocated in cells
+    int changed_capacity;       // positions allocated in changed, more changes fall back to full_redraw
+    int full_redraw;            // 1 when the screen must be cleared and every position drawn
+    int mode;                   // DRAW_GAME_OVER, DRAW_WIN or DRAW_MENU
+    int points;
+    char level_name[256];
+} frame_t;
+
+/*Empties a frame, its arrays are allocated by the first frame_publish*/
+void frame_init(frame_t *frame);
+
+/*Frees the arrays of a frame*/
+void frame_free(frame_t *frame);
+
+/*What a frame keeps of a board position: the cell without CELL_DIRTY, with FRAME_CHARGED on a charged ghost.
+The board lock must be held*/
+board_pos_t frame_cell(const board_t *board, int index);
+
+/*Copies the positions changed since the last call, or the whole board after a load or a restore, into frame
+and clears their dirty marks. The positions stay marked CELL_DIRTY in frame until frame_take.
+The board lock must be held, returns -1 if out of memory*/
+int frame_publish(frame_t *frame, board_t *board, int mode);
+
+/*Moves what was published in from into to, which is what gets drawn, returns -1 if out of memory*/
+int frame_take(frame_t *to, frame_t *from);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef GHOST_POOL_H
+#define GHOST_POOL_H
+
+#include "board.h"
+#include "tick.h"
+#include <pthread.h>
+
+// below this many ghosts per worker planning stays on the calling thread
+#define POOL_MIN_GHOSTS_PER_WORKER 32
+
+// fixed set of threads that lives for the whole process and moves the ghosts of whatever level it is attached to
+typedef struct {
+    int n_workers;
+    pthread_t *workers;         // plan phase, worker w plans ghosts w, w + active, ...
+    pthread_t clock;            // paces the ticks and applies the intents
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        // any change of the fields below or of board->threads_live, uses CLOCK_MONOTONIC
+    board_t *board;             // attached level, NULL when detached
+    ghost_intent_t *intents;    // one per ghost of the attached level
+    int intents_size;
+    unsigned long job;          // bumped for every plan phase
+    int active;                 // workers taking part in the current job
+    int pending;                // workers still planning the current job
+    int clock_parked;           // 1 while the clock thread is waiting to be started
+    int exiting;
+    long stop_latency_us;       // how long the last ghost_pool_stop waited for the clock to park
+    tick_pacer_t pacer;         // the clock thread on board->timeline, read it only while the clock is stopped
+} ghost_pool_t;
+
+/*Creates the pool threads, n_workers <= 0 uses one worker per online core*/
+int ghost_pool_init(ghost_pool_t *pool, int n_workers);
+
+/*Stops and joins every pool thread*/
+void ghost_pool_destroy(ghost_pool_t *pool);
+
+/*Retargets the pool at a loaded level, no thread is created*/
+void ghost_pool_attach(ghost_pool_t *pool, board_t *board);
+
+/*Detaches the pool from its level, the clock must be stopped*/
+void ghost_pool_detach(ghost_pool_t *pool);
+
+/*Starts board->timeline and makes the clock thread tick the attached level on its deadlines
+Between ticks the clock waits on the pool condition variable, so a stop wakes it right away*/
+void ghost_pool_start(ghost_pool_t *pool);
+
+/*Parks the clock thread, returns once no tick is in progress*/
+void ghost_pool_stop(ghost_pool_t *pool);
+
+/*Runs one tick on the calling thread (planning may use the workers), the clock must be stopped
+Returns DEAD_PACMAN if a ghost killed the pacman*/
+int ghost_pool_tick(ghost_pool_t *pool);
+
+/*Threads do not survive fork(), the child calls this to recreate them*/
+int ghost_pool_after_fork(ghost_pool_t *pool);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// keys waiting to be played, a power of two
+#define INPUT_QUEUE_SIZE 64
+
+// longest input_wait, so a pacman killed while the player is idle is still noticed
+#define INPUT_IDLE_MS 100
+
+// reads the keyboard on its own thread, blocked in poll() until a key or a stop arrives
+// keys go through a single producer single consumer ring, no lock is taken on either side
+typedef struct {
+    pthread_t thread;
+    int running;
+    int wake[2];                // pipe written by input_stop to end the poll of the input thread
+    int notify[2];              // non blocking pipe, a byte for every batch of keys queued
+    char keys[INPUT_QUEUE_SIZE];
+    atomic_uint head;           // next key to take, only moved by the game thread
+    atomic_uint tail;           // next free slot, only moved by the input thread
+    int escape;                 // where the input thread is in an escape sequence, those bytes are not keys
+    long dropped;               // keys lost because the queue was full
+} input_t;
+
+/*Creates the pipes, returns -1 on error*/
+int input_init(input_t *input);
+
+/*Starts the input thread. If no thread can be created, input_take reads stdin itself*/
+void input_start(input_t *input);
+
+/*Stops and joins the input thread, the queued keys are kept. Must be called before fork*/
+void input_stop(input_t *input);
+
+/*Closes the pipes, the input thread must be stopped*/
+void input_destroy(input_t *input);
+
+/*Returns the next queued key, '\0' if there is none, never blocks*/
+char input_take(input_t *input);
+
+/*Blocks until a key is queued or timeout_ms pass*/
+void input_wait(input_t *input, int timeout_ms);
+
+/*Drops the queued keys, used once another process has consumed the same keyboard*/
+void input_drop(input_t *input);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef LEVEL_LOADER_H
+#define LEVEL_LOADER_H
+
+#include "board.h"
+#include <pthread.h>
+
+// loads the next level on its own thread while the current one is played
+typedef struct {
+    pthread_t thread;
+    int busy;                   // 1 from level_loader_start until level_loader_wait joins the thread
+    board_t *board;             // spare board being filled
+    char *dirpath;
+    char *file;
+    uint64_t seed;
+    int result;                 // load_level_file result of the last load
+    long load_us;               // how long the last load took on the loader thread
+} level_loader_t;
+
+/*Opens dirpath/file and loads it into board with the given seed and pacman points, returns -1 on error*/
+int load_level_file(board_t *board, char *dirpath, char *file, uint64_t seed, int points);
+
+/*Initializes an idle loader*/
+void level_loader_init(level_loader_t *loader);
+
+/*Starts loading dirpath/file into the spare board, pacman points are left at 0.
+If no thread can be created the level is loaded before returning*/
+void level_loader_start(level_loader_t *loader, board_t *board, char *dirpath, char *file, uint64_t seed);
+
+/*Waits for the load in progress, if any, and returns its result. Must be called before fork*/
+int level_loader_wait(level_loader_t *loader);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// levels of the debug file, anything above LOG_LEVEL is compiled out (make LOG_LEVEL=<n>)
+// debug_trace and not trace, ncurses already has a trace function
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_DEBUG 2
+#define LOG_LEVEL_TRACE 3   // every frame and every key
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// bytes of the ring of each thread that logs, a power of two
+// a record that finds the ring full is dropped, one bigger than the whole ring is written straight to the file
+#define LOG_RING_SIZE (64 * 1024)
+// longest text record, longer ones are cut
+#define LOG_LINE_MAX 1024
+// how often the writer thread drains the rings into the file
+#define LOG_FLUSH_MS 20
+
+// turns a binary record into text, runs on the writer thread
+typedef void (*log_formatter_t)(FILE *file, const void *data, size_t size);
+
+// one piece of a binary record, the pieces are copied one after the other
+typedef struct {
+    const void *data;
+    size_t size;
+} log_part_t;
+
+/*Opens the debug file and starts the writer thread, records logged before this are dropped*/
+void open_debug_file(char *filename);
+
+/*Writes everything logged so far, stops the writer thread and closes the debug file*/
+void close_debug_file();
+
+/*Formats a line into the ring of the calling thread, never blocks and never touches the file*/
+void log_text(int level, const char *format, ...);
+
+/*Copies the parts into the ring of the calling thread, formatter makes them text on the writer thread.
+Parts bigger than a ring are formatted and written by the calling thread, which waits for the file*/
+void log_binary(int level, log_formatter_t formatter, const log_part_t *parts, int n_parts);
+
+/*Writes everything logged so far and joins the writer thread, must be called before fork*/
+void log_before_fork(void);
+
+/*Starts the writer thread again after fork, in the parent and in the child (child = 1)
+the child drops the rings of the threads it did not inherit*/
+void log_after_fork(int child);
+
+#define log_at(level, ...) do { if ((level) <= LOG_LEVEL) log_text((level), __VA_ARGS__); } while (0)
+
+/*Writes to the open debug file*/
+#define debug(...) log_at(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/*Writes to the open debug file, for what happens every frame or every key*/
+#define debug_trace(...) log_at(LOG_LEVEL_TRACE, __VA_ARGS__)
+
+#endif
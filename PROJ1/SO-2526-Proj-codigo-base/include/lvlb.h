@@ -0,0 +1,29 @@
+#ifndef LVLB_H
+#define LVLB_H
+
+#include "board.h"
+#include "file_manager.h"
+
+// compiled level, written by bin/lvlc and loaded by load_level without parsing
+#define LVLB_MAGIC "LVLB"
+#define LVLB_VERSION 1
+#define LVLB_EXTENSION ".lvlb"
+
+/* File layout, every number is a native int32_t:
+ *   header       magic[4] version width height tempo n_pacmans n_ghosts
+ *   names        pacman_file and then one per ghost, each as its length followed by the bytes
+ *   pacmans      pos_x pos_y passo n_moves, n_pacmans times
+ *   ghosts       pos_x pos_y passo n_moves, n_ghosts times
+ *   moves        command turns turns_left, for every move of every pacman and then every ghost
+ *   board        width * height packed board_pos_t, agents included */
+
+/*Checks if the contents of a level file are a compiled level*/
+int lvlb_is_binary(const file_view_t *view);
+
+/*Loads a compiled level into the board arena, the caller builds the tables, returns -1 if malformed*/
+int lvlb_load(board_t *board, const file_view_t *view, int points);
+
+/*Writes a level loaded by load_level as a compiled level, returns -1 on error*/
+int lvlb_write(const board_t *board, int fd);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "board.h"
+#include "display.h"
+#include <pthread.h>
+
+// draws the published frames on its own thread, the only thread that calls ncurses once started
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        // a frame was published or a stop was requested
+    frame_t published;          // back buffer, filled by renderer_publish under board->lock
+    frame_t shown;              // front buffer, only touched by the render thread while it runs
+    int pending;                // 1 when published has something the render thread has not taken
+    int running;
+    int stopping;
+    long frames_published;
+    long frames_drawn;          // less than published when ticks came faster than the terminal
+} renderer_t;
+
+/*Initializes a stopped renderer with empty frames*/
+void renderer_init(renderer_t *renderer);
+
+/*Starts the render thread. If no thread can be created, renderer_publish draws right away instead*/
+void renderer_start(renderer_t *renderer);
+
+/*Draws whatever was published and joins the render thread. Must be called before fork*/
+void renderer_stop(renderer_t *renderer);
+
+/*Frees the frames, the renderer must be stopped*/
+void renderer_destroy(renderer_t *renderer);
+
+/*Copies the positions changed since the last call, or the whole board after a load or a restore,
+into the back buffer and wakes the render thread. Never waits on the terminal*/
+void renderer_publish(renderer_t *renderer, board_t *board, int mode);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "savefile.h"
+#include <stdio.h>
+
+#define REPLAY_MAGIC "PREC"
+#define REPLAY_VERSION 1
+
+/* File layout, numbers are native:
+ *   session      the header and names of a save file (see savefile.h) without the saved level
+ *   events       until the end of the file, each as int32 tick type value */
+
+// what an event records, ticks count the play_board calls since the session started
+#define REPLAY_KEY 0        // value is the key play_board took at that tick
+#define REPLAY_LEVEL 1      // value is the index of the level that started
+#define REPLAY_END 2        // value is the points of the pacman when the session ended
+
+typedef struct {
+    int32_t tick;
+    int32_t type;
+    int32_t value;
+} replay_event_t;
+
+// a session being recorded to a file, or a recorded one being played again
+typedef struct {
+    FILE *file;                 // recording, every event is flushed so a crash keeps what came before it
+    replay_event_t *events;     // replaying, every event of the log
+    int n_events;
+    int next;                   // first event not replayed yet
+    long diverged;              // tick where the replay stopped matching the log, -1 while it matches
+} replay_t;
+
+/*Creates the log at path and writes the session header, returns -1 on error*/
+int replay_record_start(replay_t *replay, const char *path, const session_t *session);
+
+/*Appends an event to the log being recorded*/
+void replay_record(replay_t *replay, long tick, int type, int value);
+
+/*Closes the log being recorded*/
+void replay_record_stop(replay_t *replay);
+
+/*Reads a whole log, session gets what the header holds (lvl_files is allocated, level is 0), returns -1 on error*/
+int replay_open(replay_t *replay, const char *path, session_t *session);
+
+/*Key recorded for tick, '\0' if none was, 'Q' once the log has nothing more to give*/
+char replay_key(replay_t *replay, long tick);
+
+/*Compares a level change or the end of the session with the next event of the log, a mismatch sets diverged*/
+void replay_check(replay_t *replay, long tick, int type, int value);
+
+/*Frees the events of a log that was replayed*/
+void replay_close(replay_t *replay);
+
+#endif
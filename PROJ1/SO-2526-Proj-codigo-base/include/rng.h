@@ -0,0 +1,23 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// xoshiro128** generator, every agent owns one so random moves need no shared state
+typedef struct {
+    uint32_t s[4];
+} rng_t;
+
+/*Seeds a generator for one stream of a master seed, different streams give independent sequences*/
+void rng_seed(rng_t *rng, uint64_t seed, uint64_t stream);
+
+/*Returns the next 32 random bits*/
+uint32_t rng_next(rng_t *rng);
+
+/*Returns a value in [0, n)*/
+uint32_t rng_below(rng_t *rng, uint32_t n);
+
+/*Mixes two values into a new seed, used to give every level its own seed*/
+uint64_t rng_mix(uint64_t seed, uint64_t value);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#include "board.h"
+#include "file_manager.h"
+#include <stdio.h>
+
+#define SAVEFILE_MAGIC "PSAV"
+#define SAVEFILE_VERSION 1
+
+/* File layout, numbers are native:
+ *   header       magic[4] int32 version, uint64 seed, int32 saved level, int32 level count
+ *   names        level_dir and then every level file, each as an int32 length followed by the bytes
+ *   agents       int32 n_pacmans n_ghosts, then per pacman alive points current_move waiting rng[4]
+ *                and per ghost current_move waiting charged rng[4]
+ *   level        the saved level as a compiled level (see lvlb.h), with its eaten dots, positions and 'T' counters */
+
+// what is needed to go on with a session, so resuming skips scanning the level directory
+typedef struct {
+    uint64_t seed;
+    char level_dir[2 * MAX_FILENAME];
+    char **lvl_files;           // every level of the session, freed with free_lvl_files
+    int count;
+    int level;                  // index of the saved level in lvl_files
+} session_t;
+
+// a format that starts with the header and names of a session, save files and replay logs (see replay.h)
+typedef struct {
+    const char *magic;          // 4 bytes
+    int32_t version;
+    int has_level;              // the saved level comes between the seed and the level count
+    const char *what;           // names the file in error messages
+} session_format_t;
+
+/*Writes the header and the names of a session, errors are left in the stream for fflush or fclose to report*/
+void session_write_header(FILE *file, const session_format_t *format, const session_t *session);
+
+/*Reads the header and the names of a session, lvl_files is allocated and level is 0 if the format has none.
+Returns -1 on error, with nothing left allocated*/
+int session_read_header(view_reader_t *r, const session_format_t *format, session_t *session);
+
+/*Writes the board state and the session to path, through a temporary file so an old save is never half overwritten.
+The ghosts must not be moving, returns -1 on error*/
+int save_game(const char *path, const board_t *board, const session_t *session);
+
+/*Reads the session part of a save file, lvl_files is allocated, returns -1 on error*/
+int read_save_session(const char *path, session_t *session);
+
+/*Loads the saved level and its state into board, board->arena must be initialized, returns -1 on error*/
+int load_saved_level(const char *path, board_t *board);
+
+#endif
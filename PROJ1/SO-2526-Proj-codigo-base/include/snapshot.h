@@ -0,0 +1,50 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "board.h"
+#include <stddef.h>
+
+#define SNAPSHOT_NAME_SIZE 32
+
+// slot 'G' saves to
+#define QUICKSAVE_SLOT "quick"
+
+// state of a level at one tick, the tables stay in the level arena
+typedef struct {
+    char name[SNAPSHOT_NAME_SIZE];
+    int level;                  // index of the level in the level list
+    int width, height;
+    int n_pacmans, n_ghosts;
+    size_t size;                // bytes used in data
+    size_t capacity;
+    unsigned char *data;        // board cells, the pacmans, the ghosts and then every move script
+} snapshot_t;
+
+// named snapshot slots, a slot keeps its buffer when saved again
+typedef struct {
+    snapshot_t *slots;
+    int n_slots;
+    int capacity;
+} snapshot_store_t;
+
+/*Initializes an empty store*/
+void snapshot_store_init(snapshot_store_t *store);
+
+/*Frees every slot*/
+void snapshot_store_free(snapshot_store_t *store);
+
+/*Captures the board into the named slot, replacing what it held, returns -1 if out of memory.
+The ghosts must not be moving*/
+int snapshot_save(snapshot_store_t *store, const char *name, const board_t *board, int level);
+
+/*Returns the named slot or NULL if it is empty*/
+snapshot_t *snapshot_find(snapshot_store_t *store, const char *name);
+
+/*Empties the named slot*/
+void snapshot_drop(snapshot_store_t *store, const char *name);
+
+/*Puts the board back to the snapshot, the board must hold snap->level, returns -1 if it does not match.
+The ghosts must not be moving*/
+int snapshot_restore(const snapshot_t *snap, board_t *board);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <time.h>
+
+// timings of the hot paths, built in with make STATS=1, otherwise every macro below is empty
+#ifndef STATS
+#define STATS 0
+#endif
+
+// what is timed, each one gets its own histogram
+typedef enum {
+    STAT_PLAY_BOARD,        // one pacman tick, play_board
+    STAT_MOVE_PACMAN,       // move_pacman, under board->lock
+    STAT_GHOST_PLAN,        // plan phase of a ghost tick, every ghost
+    STAT_GHOST_APPLY,       // apply phase of a ghost tick, every ghost, under board->lock
+    STAT_LOCK_WAIT,         // waiting for board->lock, 0 when it was free
+    STAT_DRAW,              // draw_frame
+    STAT_REFRESH,           // refresh_screen
+    STAT_TICK,              // from the deadline of a tick to the end of its work, over the tempo is an overrun
+    STAT_COUNT
+} stat_t;
+
+// histogram buckets: exact below 2^(STATS_SUB_BITS + 1) ns, then 2^STATS_SUB_BITS per power of two (about 3% wide)
+// up to 2^STATS_MAX_BITS ns, longer times land in the last bucket
+#define STATS_SUB_BITS 5
+#define STATS_MAX_BITS 40
+#define STATS_BUCKETS ((STATS_MAX_BITS - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
+#if STATS
+
+static inline long long stats_now(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*Adds a time in ns to a histogram, safe from any thread*/
+void stats_add(stat_t stat, long long ns);
+
+/*Writes the histograms of the level to the debug file, adds them to the totals and clears them*/
+void stats_level_end(const char *level_name, int tempo_ms);
+
+/*Writes the totals of the whole run to the debug file*/
+void stats_exit(void);
+
+#define stats_start(var) long long var = stats_now()
+#define stats_stop(stat, var) stats_add((stat), stats_now() - (var))
+
+#else
+
+#define stats_start(var) do {} while (0)
+#define stats_stop(stat, var) do {} while (0)
+#define stats_add(stat, ns) do {} while (0)
+#define stats_level_end(level_name, tempo_ms) do {} while (0)
+#define stats_exit() do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef TICK_H
+#define TICK_H
+
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// waits on CLOCK_MONOTONIC deadlines need clock selection, which macOS lacks
+// there, or with REALTIME_WAIT defined, they are turned into waits relative to now
+#if defined(_POSIX_CLOCK_SELECTION) && _POSIX_CLOCK_SELECTION > 0 && !defined(REALTIME_WAIT)
+#define TICK_CLOCK_SELECTION 1
+#else
+#define TICK_CLOCK_SELECTION 0
+#endif
+
+// ticks of a level, tick n is due at epoch + n * period on CLOCK_MONOTONIC
+// the pacman loop and the ghost clock both pace themselves on the same one
+typedef struct {
+    struct timespec epoch;
+    long period_ns;         // 0 when the level has no tempo, ticks are never waited for
+} tick_timeline_t;
+
+// where one thread is on a timeline, and how often it fell behind it
+typedef struct {
+    long tick;              // tick being run, its deadline has already passed
+    long ticks;             // ticks run since tick_pacer_init
+    long overruns;          // ticks whose work ended after the next deadline
+    long skipped;           // deadlines dropped to catch up after an overrun longer than a period
+    long max_late_us;       // worst lateness of a deadline
+} tick_pacer_t;
+
+/*Makes now the epoch of the timeline, tick 0 is due right away*/
+void tick_timeline_start(tick_timeline_t *timeline, int tempo_ms);
+
+/*Clears the position and the metrics of a pacer*/
+void tick_pacer_init(tick_pacer_t *pacer);
+
+/*Goes back to tick 0, used whenever the timeline is started again, the metrics are kept*/
+void tick_pacer_restart(tick_pacer_t *pacer);
+
+/*Moves the pacer to its next tick and gives its absolute deadline.
+A deadline already past is an overrun, run right away, or skipped along with the rest if a whole period was missed*/
+void tick_pacer_next(tick_pacer_t *pacer, const tick_timeline_t *timeline, struct timespec *deadline);
+
+/*tick_pacer_next and then tick_sleep_until the deadline*/
+void tick_pacer_sleep(tick_pacer_t *pacer, const tick_timeline_t *timeline);
+
+/*What is left of an absolute CLOCK_MONOTONIC deadline, zero once it has passed*/
+static inline struct timespec tick_remaining(const struct timespec *deadline){
+    struct timespec now, left;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    left.tv_sec = deadline->tv_sec - now.tv_sec;
+    left.tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if(left.tv_nsec < 0){
+        left.tv_sec--;
+        left.tv_nsec += 1000000000L;
+    }
+    if(left.tv_sec < 0){
+        left.tv_sec = 0;
+        left.tv_nsec = 0;
+    }
+    return left;
+}
+
+/*Sleeps until an absolute CLOCK_MONOTONIC deadline, a sleep cut short by a signal is resumed.
+Without clock selection it sleeps what is left of the deadline, measured again after each signal*/
+static inline void tick_sleep_until(const struct timespec *deadline){
+#if TICK_CLOCK_SELECTION
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR){
+    }
+#else
+    struct timespec left = tick_remaining(deadline);
+    while(nanosleep(&left, NULL) == -1 && errno == EINTR){
+        left = tick_remaining(deadline);
+    }
+#endif
+}
+
+/*Inits a condition whose timed waits take CLOCK_MONOTONIC deadlines, for tick_cond_timedwait*/
+static inline void tick_cond_init(pthread_cond_t *cond){
+#if TICK_CLOCK_SELECTION
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+/*pthread_cond_timedwait until an absolute CLOCK_MONOTONIC deadline, returns ETIMEDOUT once it has passed.
+Without clock selection the condition runs on CLOCK_REALTIME, the deadline becomes now plus what is left of it,
+so a wall clock change only moves the one wait it falls in*/
+static inline int tick_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *deadline){
+#if TICK_CLOCK_SELECTION
+    return pthread_cond_timedwait(cond, mutex, deadline);
+#else
+    struct timespec left = tick_remaining(deadline);
+    if(left.tv_sec == 0 && left.tv_nsec == 0) return ETIMEDOUT;
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    wall.tv_sec += left.tv_sec;
+    wall.tv_nsec += left.tv_nsec;
+    if(wall.tv_nsec >= 1000000000L){
+        wall.tv_sec++;
+        wall.tv_nsec -= 1000000000L;
+    }
+    int status = pthread_cond_timedwait(cond, mutex, &wall);
+    if(status == ETIMEDOUT){
+        //the wall clock jumped forward, the monotonic deadline is still ahead and the caller waits again
+        left = tick_remaining(deadline);
+        if(left.tv_sec || left.tv_nsec) return 0;
+    }
+    return status;
+#endif
+}
+
+#endif
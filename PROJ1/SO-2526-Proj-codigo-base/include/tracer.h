@@ -0,0 +1,31 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+// events a thread keeps before writing them out, a full buffer is written by the thread that filled it
+#define TRACER_BUFFER_EVENTS 1024
+
+// set by tracer_open, read by the macros below so a run without --trace only pays for the test
+extern int tracer_enabled;
+
+/*Starts a Chrome trace-event JSON file (load it in chrome://tracing or ui.perfetto.dev), returns -1 on error
+Events are kept per thread and appended to the file, forked children write into the same file*/
+int tracer_open(const char *path);
+
+/*Writes what the calling thread still holds and, in the process that opened it, ends the JSON array.
+Threads that exited wrote their events already, the ones still running drop what they had not written*/
+void tracer_close(void);
+
+/*Names the calling thread in the trace*/
+void tracer_thread(const char *name);
+
+/*Records the begin ('B') or the end ('E') of a slice named name, name must be a string literal*/
+void tracer_event(char phase, const char *name);
+
+/*Called in the child right after fork, the events copied from the parent are dropped and the process is named*/
+void tracer_after_fork(const char *process_name);
+
+#define trace_begin(name) do { if (tracer_enabled) tracer_event('B', (name)); } while (0)
+#define trace_end(name) do { if (tracer_enabled) tracer_event('E', (name)); } while (0)
+#define trace_thread(name) do { if (tracer_enabled) tracer_thread(name); } while (0)
+
+#endif
@@ -0,0 +1,106 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+
+//header size rounded up so the data after it stays aligned
+#define HEADER_SIZE ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static inline char *block_data(arena_block_t *block){
+    return (char *)block + HEADER_SIZE;
+}
+
+void arena_init(arena_t *arena, size_t block_size){
+    arena->head = NULL;
+    arena->block_size = block_size;
+    arena->allocs = 0;
+    arena->bytes = 0;
+    arena->reserved = 0;
+}
+
+static arena_block_t *new_block(arena_t *arena, size_t size){
+    arena_block_t *block = malloc(HEADER_SIZE + size);
+    if(block != NULL){
+        arena->reserved += size;
+        block->size = size;
+        block->used = 0;
+        block->next = NULL;
+    }
+    return block;
+}
+
+void *arena_alloc(arena_t *arena, size_t size){
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena_block_t *block = arena->head;
+    if(size > arena->block_size){
+        //gets a block of its own, behind the one being filled so its free space is not lost
+        block = new_block(arena, size);
+        if(block == NULL){
+            return NULL;
+        }
+        if(arena->head == NULL){
+            arena->head = block;
+        }else{
+            block->next = arena->head->next;
+            arena->head->next = block;
+        }
+    }else if(block == NULL || block->size - block->used < size){
+        block = new_block(arena, arena->block_size);
+        if(block == NULL){
+            return NULL;
+        }
+        block->next = arena->head;
+        arena->head = block;
+    }
+    void *ptr = block_data(block) + block->used;
+    block->used += size;
+    arena->allocs++;
+    arena->bytes += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+char *arena_strdup(arena_t *arena, const char *str){
+    size_t len = strlen(str) +1;
+    char *copy = arena_alloc(arena, len);
+    if(copy != NULL){
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+void arena_reset(arena_t *arena){
+    arena_block_t *keep = NULL;
+    arena_block_t *block = arena->head;
+    //keeps the largest block, the next level is likely to need about as much
+    while(block != NULL){
+        arena_block_t *next = block->next;
+        if(keep == NULL || block->size > keep->size){
+            if(keep != NULL){
+                arena->reserved -= keep->size;
+            }
+            free(keep);
+            keep = block;
+        }else{
+            arena->reserved -= block->size;
+            free(block);
+        }
+        block = next;
+    }
+    if(keep != NULL){
+        keep->used = 0;
+        keep->next = NULL;
+    }
+    arena->head = keep;
+    arena->allocs = 0;
+    arena->bytes = 0;
+}
+
+void arena_release(arena_t *arena){
+    arena_reset(arena);
+    free(arena->head);
+    arena->head = NULL;
+    arena->reserved = 0;
+}
@@ -1,20 +1,20 @@
 #include "board.h"
 #include "file_manager.h"
+#include "lvlb.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
 #include <unistd.h>
-#include <stdarg.h>
 #include <string.h>
 
-FILE * debugfile;
 
 // Helper private function to find and kill pacman at specific position
 static int find_and_kill_pacman(board_t* board, int new_x, int new_y) {
-    for (int p = 0; p < board->n_pacmans; p++) {
-        pacman_t* pac = &board->pacmans[p];
-        if (pac->pos_x == new_x && pac->pos_y == new_y && pac->alive) {
-            pac->alive = 0;
+    int agent = board_agent_at(board, new_y * board->width + new_x);
+    if (AGENT_IS_PACMAN(agent)) {
+        int p = AGENT_PACMAN_INDEX(agent);
+        if (board->pacmans[p].alive) {
+            board->pacmans[p].alive = 0;
             kill_pacman(board, p);
             return DEAD_PACMAN;
         }
@@ -59,7 +59,7 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
 
     if (direction == 'R') {
         char directions[] = {'W', 'S', 'A', 'D'};
-        direction = directions[rand() % 4];
+        direction = directions[rng_below(&pac->rng, 4)];
     }
 
     // Calculate new position based on direction
@@ -97,11 +97,13 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
 
     int new_index = get_board_index(board, new_x, new_y);
     int old_index = get_board_index(board, pac->pos_x, pac->pos_y);
-    char target_content = board->board[new_index].content;
+    char target_content = board_content(board, new_index);
 
-    if (board->board[new_index].has_portal) {
-        board->board[old_index].content = ' ';
-        board->board[new_index].content = 'P';
+    if (board_has_portal(board, new_index)) {
+        board_set_content(board, old_index, ' ');
+        board_set_content(board, new_index, 'P');
+        board_set_agent(board, old_index, NO_AGENT);
+        board_set_agent(board, new_index, PACMAN_AGENT(pacman_index));
         return REACHED_PORTAL;
     }
 
@@ -117,95 +119,108 @@ int move_pacman(board_t* board, int pacman_index, command_t* command) {
     }
 
     // Collect points
-    if (board->board[new_index].has_dot) {
+    if (board_has_dot(board, new_index)) {
         pac->points++;
-        board->board[new_index].has_dot = 0;
+        board_set_dot(board, new_index, 0);
     }
 
-    board->board[old_index].content = ' ';
+    board_set_content(board, old_index, ' ');
+    board_set_agent(board, old_index, NO_AGENT);
     pac->pos_x = new_x;
     pac->pos_y = new_y;
-    board->board[new_index].content = 'P';
+    board_set_content(board, new_index, 'P');
+    board_set_agent(board, new_index, PACMAN_AGENT(pacman_index));
     return VALID_MOVE;
 }
 
+// Helper private function, lowest set bit in [from, to] or -1
+static int first_bit(const uint64_t* bits, int from, int to) {
+    if (from > to) return -1;
+    int w = from >> 6;
+    int last = to >> 6;
+    uint64_t word = bits[w] & (~0ULL << (from & 63));
+    while (1) {
+        if (w == last) word &= ~0ULL >> (63 - (to & 63));
+        if (word) return (w << 6) + __builtin_ctzll(word);
+        if (w == last) return -1;
+        word = bits[++w];
+    }
+}
+
+// Helper private function, highest set bit in [from, to] or -1
+static int last_bit(const uint64_t* bits, int from, int to) {
+    if (from > to) return -1;
+    int w = to >> 6;
+    int first = from >> 6;
+    uint64_t word = bits[w] & (~0ULL >> (63 - (to & 63)));
+    while (1) {
+        if (w == first) word &= ~0ULL << (from & 63);
+        if (word) return (w << 6) + 63 - __builtin_clzll(word);
+        if (w == first) return -1;
+        word = bits[--w];
+    }
+}
+
 // Helper private function for charged ghost movement in one direction
+// the wall bitmaps give how far the ghost can go, the agent bitmaps give the first 'P' or 'M' in that range
 static int move_ghost_charged_direction(board_t* board, ghost_t* ghost, char direction, int* new_x, int* new_y) {
     int x = ghost->pos_x;
     int y = ghost->pos_y;
+    size_t row_at = (size_t)y * board->row_words;
+    size_t col_at = (size_t)x * board->col_words;
+    const uint64_t* row = board->row_agents + row_at;
+    const uint64_t* col = board->col_agents + col_at;
+    int wall, end, hit;
     *new_x = x;
     *new_y = y;
-    
+
     switch (direction) {
         case 'W': // Up
             if (y == 0) return INVALID_MOVE;
-            *new_y = 0; // In case there is no colision
-            for (int i = y - 1; i >= 0; i--) {
-                char target_content = board->board[get_board_index(board, x, i)].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    *new_y = i + 1; // stop before colision
-                    return VALID_MOVE;
-                }
-                else if (target_content == 'P') {
-                    *new_y = i;
-                    return find_and_kill_pacman(board, *new_x, *new_y);
-                }
-            }
+            wall = last_bit(board->col_walls + col_at, 0, y - 1);
+            end = wall + 1;
+            hit = last_bit(col, end, y - 1);
+            *new_y = (hit < 0) ? end : hit;
             break;
 
         case 'S': // Down
             if (y == board->height - 1) return INVALID_MOVE;
-            *new_y = board->height - 1; // In case there is no colision
-            for (int i = y + 1; i < board->height; i++) {
-                char target_content = board->board[get_board_index(board, x, i)].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    *new_y = i - 1; // stop before colision
-                    return VALID_MOVE;
-                }
-                if (target_content == 'P') {
-                    *new_y = i;
-                    return find_and_kill_pacman(board, *new_x, *new_y);
-                }
-            }
+            wall = first_bit(board->col_walls + col_at, y + 1, board->height - 1);
+            end = (wall < 0) ? board->height - 1 : wall - 1;
+            hit = first_bit(col, y + 1, end);
+            *new_y = (hit < 0) ? end : hit;
             break;
 
         case 'A': // Left
             if (x == 0) return INVALID_MOVE;
-            *new_x = 0; // In case there is no colision
-            for (int j = x - 1; j >= 0; j--) {
-                char target_content = board->board[get_board_index(board, j, y)].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    *new_x = j + 1; // stop before colision
-                    return VALID_MOVE;
-                }
-                if (target_content == 'P') {
-                    *new_x = j;
-                    return find_and_kill_pacman(board, *new_x, *new_y);
-                }
-            }
+            wall = last_bit(board->row_walls + row_at, 0, x - 1);
+            end = wall + 1;
+            hit = last_bit(row, end, x - 1);
+            *new_x = (hit < 0) ? end : hit;
             break;
 
         case 'D': // Right
             if (x == board->width - 1) return INVALID_MOVE;
-            *new_x = board->width - 1; // In case there is no colision
-            for (int j = x + 1; j < board->width; j++) {
-                char target_content = board->board[get_board_index(board, j, y)].content;
-                if (target_content == 'W' || target_content == 'M') {
-                    *new_x = j - 1; // stop before colision
-                    return VALID_MOVE;
-                }
-                if (target_content == 'P') {
-                    *new_x = j;
-                    return find_and_kill_pacman(board, *new_x, *new_y);
-                }
-            }
+            wall = first_bit(board->row_walls + row_at, x + 1, board->width - 1);
+            end = (wall < 0) ? board->width - 1 : wall - 1;
+            hit = first_bit(row, x + 1, end);
+            *new_x = (hit < 0) ? end : hit;
             break;
         default:
-            debug("DEFAULT CHARGED MOVE - direction = %c\n", direction);
+            debug_trace("DEFAULT CHARGED MOVE - direction = %c\n", direction);
             return INVALID_MOVE;
     }
-    return VALID_MOVE;
-}   
+    if (hit < 0) {
+        return VALID_MOVE; // In case there is no colision
+    }
+    if (board_content(board, get_board_index(board, *new_x, *new_y)) == 'M') {
+        // stop before colision
+        if (*new_x != x) *new_x += (*new_x < x) ? 1 : -1;
+        else *new_y += (*new_y < y) ? 1 : -1;
+        return VALID_MOVE;
+    }
+    return find_and_kill_pacman(board, *new_x, *new_y);
+}
 
 int move_ghost_charged(board_t* board, int ghost_index, char direction) {
     ghost_t* ghost = &board->ghosts[ghost_index];
@@ -217,7 +232,8 @@ int move_ghost_charged(board_t* board, int ghost_index, char direction) {
     ghost->charged = 0; //uncharge
     int result = move_ghost_charged_direction(board, ghost, direction, &new_x, &new_y);
     if (result == INVALID_MOVE) {
-        debug("DEFAULT CHARGED MOVE - direction = %c\n", direction);
+        debug_trace("DEFAULT CHARGED MOVE - direction = %c\n", direction);
+        board_mark_dirty(board, get_board_index(board, x, y)); // no longer drawn charged
         return INVALID_MOVE;
     }
 
@@ -226,24 +242,27 @@ int move_ghost_charged(board_t* board, int ghost_index, char direction) {
     int new_index = get_board_index(board, new_x, new_y);
 
     // Update board - clear old position (restore what was there)
-    board->board[old_index].content = ' '; // Or restore the dot if ghost was on one
+    board_set_content(board, old_index, ' '); // Or restore the dot if ghost was on one
+    board_set_agent(board, old_index, NO_AGENT);
     // Update ghost position
     ghost->pos_x = new_x;
     ghost->pos_y = new_y;
     // Update board - set new position
-    board->board[new_index].content = 'M';
+    board_set_content(board, new_index, 'M');
+    board_set_agent(board, new_index, ghost_index);
     return result;
 }
 
-int move_ghost(board_t* board, int ghost_index, command_t* command) {
+void plan_ghost(board_t* board, int ghost_index, command_t* command, ghost_intent_t* intent) {
     ghost_t* ghost = &board->ghosts[ghost_index];
-    int new_x = ghost->pos_x;
-    int new_y = ghost->pos_y;
+    intent->direction = '\0';
+    intent->charged = 0;
+    intent->result = VALID_MOVE;
 
     // check passo
     if (ghost->waiting > 0) {
         ghost->waiting -= 1;
-        return VALID_MOVE;
+        return;
     }
     ghost->waiting = ghost->passo;
 
@@ -251,42 +270,66 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
     
     if (direction == 'R') {
         char directions[] = {'W', 'S', 'A', 'D'};
-        direction = directions[rand() % 4];
+        direction = directions[rng_below(&ghost->rng, 4)];
     }
 
-    // Calculate new position based on direction
     switch (direction) {
         case 'W': // Up
-            new_y--;
-            break;
         case 'S': // Down
-            new_y++;
-            break;
         case 'A': // Left
-            new_x--;
-            break;
         case 'D': // Right
-            new_x++;
             break;
         case 'C': // Charge
             ghost->current_move += 1;
             ghost->charged = 1;
-            return VALID_MOVE;
+            intent->charged = 1; // drawn charged from now on, apply_ghost marks the position
+            return;
         case 'T': // Wait
             if (command->turns_left == 1) {
                 ghost->current_move += 1; // move on
                 command->turns_left = command->turns;
             }
             else command->turns_left -= 1;
-            return VALID_MOVE;
+            return;
         default:
-            return INVALID_MOVE; // Invalid direction
+            intent->result = INVALID_MOVE; // Invalid direction
+            return;
     }
 
     // Logic for the WASD movement
     ghost->current_move++;
-    if (ghost->charged)
-        return move_ghost_charged(board, ghost_index, direction);
+    intent->direction = direction;
+    intent->charged = ghost->charged;
+}
+
+int apply_ghost(board_t* board, int ghost_index, ghost_intent_t* intent) {
+    ghost_t* ghost = &board->ghosts[ghost_index];
+    int new_x = ghost->pos_x;
+    int new_y = ghost->pos_y;
+
+    if (intent->direction == '\0') {
+        if (intent->charged)
+            board_mark_dirty(board, get_board_index(board, ghost->pos_x, ghost->pos_y));
+        return intent->result;
+    }
+    if (intent->charged)
+        return move_ghost_charged(board, ghost_index, intent->direction);
+
+    // Calculate new position based on direction
+    switch (intent->direction) {
+        case 'W': // Up
+            new_y--;
+            break;
+        case 'S': // Down
+            new_y++;
+            break;
+        case 'A': // Left
+            new_x--;
+            break;
+        case 'D': // Right
+            new_x++;
+            break;
+    }
 
     // Check boundaries
     if (!is_valid_position(board, new_x, new_y)) {
@@ -296,7 +339,7 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
     // Check board position
     int new_index = get_board_index(board, new_x, new_y);
     int old_index = get_board_index(board, ghost->pos_x, ghost->pos_y);
-    char target_content = board->board[new_index].content;
+    char target_content = board_content(board, new_index);
 
     // Check for walls and ghosts
     if (target_content == 'W' || target_content == 'M') {
@@ -310,235 +353,451 @@ int move_ghost(board_t* board, int ghost_index, command_t* command) {
     }
 
     // Update board - clear old position (restore what was there)
-    board->board[old_index].content = ' '; // Or restore the dot if ghost was on one
+    board_set_content(board, old_index, ' '); // Or restore the dot if ghost was on one
+    board_set_agent(board, old_index, NO_AGENT);
 
     // Update ghost position
     ghost->pos_x = new_x;
     ghost->pos_y = new_y;
 
     // Update board - set new position
-    board->board[new_index].content = 'M';
+    board_set_content(board, new_index, 'M');
+    board_set_agent(board, new_index, ghost_index);
 
     
     return result;
 }
 
+int move_ghost(board_t* board, int ghost_index, command_t* command) {
+    ghost_intent_t intent;
+    plan_ghost(board, ghost_index, command, &intent);
+    return apply_ghost(board, ghost_index, &intent);
+}
+
+void plan_ghosts(board_t* board, ghost_intent_t* intents, int first, int stride) {
+    for (int i = first; i < board->n_ghosts; i += stride) {
+        ghost_t* ghost = &board->ghosts[i];
+        if (ghost->n_moves == 0) {
+            intents[i].direction = '\0';
+            intents[i].result = VALID_MOVE;
+            continue;
+        }
+        plan_ghost(board, i, &ghost->moves[ghost->current_move % ghost->n_moves], &intents[i]);
+    }
+}
+
+int resolve_ghosts(board_t* board, ghost_intent_t* intents) {
+    int result = VALID_MOVE;
+    // lower indexes move first, so they win any contested position
+    for (int i = 0; i < board->n_ghosts; i++) {
+        if (apply_ghost(board, i, &intents[i]) == DEAD_PACMAN) {
+            result = DEAD_PACMAN;
+        }
+    }
+    return result;
+}
+
 void kill_pacman(board_t* board, int pacman_index) {
     debug("Killing %d pacman\n\n", pacman_index);
     pacman_t* pac = &board->pacmans[pacman_index];
     int index = pac->pos_y * board->width + pac->pos_x;
 
     // Remove pacman from the board
-    board->board[index].content = ' ';
+    board_set_content(board, index, ' ');
+    board_set_agent(board, index, NO_AGENT);
 
     // Mark pacman as dead
     pac->alive = 0;
 }
 
+// Helper private function, lines that fit here are parsed from the stack, longer ones are copied to the arena
+#define LINE_BUF 256
+
 // Static Loading
 int load_pacman(board_t* board, int fd, int points) {
 
-    char *buffer = read_file(fd);
-    char *start = buffer;
-    char *end;
+    file_view_t view;
+    if (open_view(fd, &board->arena, &view) == -1) return -1;
+    size_t cursor = 0;
+    const char *raw;
+    size_t len;
+    char small[LINE_BUF];
     int move_index=0;
+    int result = 0;
     board->pacmans[0].alive =1;
     board->pacmans[0].points = points;
-    while (*start != '\0') {
-
-        end = strchr(start, '\n');
-        if (end != NULL) {
-            *end = '\0';
+    // every line can be a move at most
+    board->pacmans[0].moves = arena_alloc(&board->arena, view_count_lines(&view) * sizeof(command_t));
+    if (board->pacmans[0].moves == NULL) result = -1;
+    while (result == 0 && view_next_line(&view, &cursor, &raw, &len)) {
+
+        if (len == 0 || raw[0] == '#')
+            continue;
+        char *start = line_cstr(&board->arena, small, sizeof(small), raw, len);
+        if (start == NULL) {
+            result = -1;
         }
-          
-        
-        if(start[0] != '#'){
-            if(strncmp(start, "POS ", 4) ==0){
-                char *rest = start + 4;
-                store_pac_pos(board, rest);
-            }
-            else if(strncmp(start, "PASSO ", 6) ==0){
-                char *rest = start +6;
-                store_pac_passo(board, rest);
-            }
-            else{
-                store_pac_moves(board, start, move_index);
-                move_index++;
-            }
+        else if(strncmp(start, "POS ", 4) ==0){
+            char *rest = start + 4;
+            result = store_pac_pos(board, rest);
+        }
+        else if(strncmp(start, "PASSO ", 6) ==0){
+            char *rest = start +6;
+            store_pac_passo(board, rest);
+        }
+        else{
+            store_pac_moves(board, start, move_index);
+            move_index++;
         }
-        if (end == NULL)
-            break; 
-        start = end + 1; // move to the next line
     }
+    close_view(&view);
     board->pacmans[0].n_moves = move_index;
-    free(buffer);
-    return 0;
+    return result;
 }
 
 // Static Loading
 int load_ghost(board_t* board, int fd, int ghost_index) {
 
-    char *buffer = read_file(fd);
-    char *start = buffer;
-    char *end;
+    file_view_t view;
+    if (open_view(fd, &board->arena, &view) == -1) return -1;
+    size_t cursor = 0;
+    const char *raw;
+    size_t len;
+    char small[LINE_BUF];
     int move_index =0;
+    int result = 0;
     board->ghosts[ghost_index].current_move= 0;
     board->ghosts[ghost_index].charged =0;
+    // every line can be a move at most
+    board->ghosts[ghost_index].moves = arena_alloc(&board->arena, view_count_lines(&view) * sizeof(command_t));
+    if (board->ghosts[ghost_index].moves == NULL) result = -1;
 
+    while (result == 0 && view_next_line(&view, &cursor, &raw, &len)) {
 
-    while (*start != '\0') {
-
-        end = strchr(start, '\n');
-        if (end != NULL) {
-            *end = '\0';
+        if (len == 0 || raw[0] == '#')
+            continue;
+        char *start = line_cstr(&board->arena, small, sizeof(small), raw, len);
+        if (start == NULL) {
+            result = -1;
+        }
+        else if(strncmp(start, "POS ", 4) ==0){
+            char *rest = start + 4;
+            result = store_mon_pos(board, ghost_index, rest);
+        }
+        else if(strncmp(start, "PASSO ", 6) ==0){
+            char *rest = start +6;
+            store_mon_passo(board, ghost_index, rest);
+        }
+        else{
+            store_mon_moves(board, ghost_index, start, move_index);
+            move_index++;
         }
-     
-        
-        if(start[0] != '#'){
-            if(strncmp(start, "POS ", 4) ==0){
-                char *rest = start + 4;
-                store_mon_pos(board, ghost_index, rest);
-            }
-            else if(strncmp(start, "PASSO ", 6) ==0){
-                char *rest = start +6;
-                store_mon_passo(board, ghost_index, rest);
-            }
-            else{
-                store_mon_moves(board, ghost_index, start, move_index);
-                move_index++;
-            }
-            
-        }   
-        if (end == NULL)
-            break; 
-        start = end + 1; // move to the next line
     }
+    close_view(&view);
     board->ghosts[ghost_index].n_moves = move_index;
-    free(buffer);
-    return 0;
+    return result;
+}
+
+// Helper private function, ghost i uses stream i and pacman p stream PACMAN_STREAM + p
+#define PACMAN_STREAM (1ULL << 32)
+static void seed_agents(board_t *board) {
+    for (int g = 0; g < board->n_ghosts; g++) {
+        rng_seed(&board->ghosts[g].rng, board->seed, g);
+    }
+    for (int p = 0; p < board->n_pacmans; p++) {
+        rng_seed(&board->pacmans[p].rng, board->seed, PACMAN_STREAM + p);
+    }
+}
+
+// Helper private function, board rows are the only lines that are not directives
+static int is_directive(const char *line, size_t len) {
+    return line_has_prefix(line, len, "DIM ") || line_has_prefix(line, len, "PAC ") ||
+           line_has_prefix(line, len, "MON ") || line_has_prefix(line, len, "TEMPO ");
 }
 
 int load_level(board_t *board, int points, int fd, char *path) {
-    char *buffer = read_file(fd);
-    char *start = buffer;
-    char *end;
+    file_view_t view;
+    if (open_view(fd, &board->arena, &view) == -1) return -1;
+    size_t cursor = 0;
+    const char *raw;
+    size_t len;
+    char small[LINE_BUF];
     int has_pac = 0;
+    int result = 0;
     int line_number =0; //used for building the board
+    board->board = NULL;
+    board->ghosts_files = NULL;
+    board->pacman_file[0] = '\0';
+    board->row_walls = board->col_walls = NULL;
+    board->agents = NULL;
+    board->dirty = NULL;
+    board->row_agents = NULL;
+    board->col_agents = NULL;
+    board->n_pacmans = 0;
+    board->pacmans = NULL;
+    board->n_ghosts = 0;
+    board->ghosts = NULL;
+
+    // a compiled level is copied as is, there is nothing to parse
+    if (lvlb_is_binary(&view)) {
+        result = lvlb_load(board, &view, points);
+        close_view(&view);
+        if (result != 0) return -1;
+        seed_agents(board);
+        return build_level_tables(board);
+    }
     
-    while (*start != '\0') {
-
-        end = strchr(start, '\n');
-        if (end != NULL) {
-            *end = '\0';
-        }
-
-        if(start[0] != '#'){
-            if(strncmp(start, "DIM ", 4) ==0){
-                char *rest = start + 4;
-                set_board_dim(rest, board);
-                
-            }else if(strncmp(start, "PAC ", 4) ==0){
-                has_pac = 1;
-                char *rest = start + 4;
-                prepare_and_read_pac_file(board, rest, points, path);
-                
-
-            }else if(strncmp(start, "MON ", 4) ==0){
-                char *rest = start +4;
-                //counting how many monsters there will be
-                set_memory_for_ghosts(board, rest);
-                prepare_and_read_mon_file(board, rest, path);
-
-            }else if(strncmp(start, "TEMPO ", 6) ==0){
-                char *rest = start + 6;
-                int tempo;
-                sscanf(rest, "%d", &tempo);
-                board->tempo =tempo;
-            }else{
-                store_game_board(board, start, line_number);
+    while (result == 0 && view_next_line(&view, &cursor, &raw, &len)) {
+
+        if (len == 0 || raw[0] == '#')
+            continue;
+
+        if (!is_directive(raw, len)) {
+            // board rows are read straight from the file, they can be as wide as the board
+            if (board->board == NULL) {
+                fprintf(stderr, "level error: DIM must come before '%.*s'\n", (int)len, raw);
+                result = -1;
+            } else {
+                result = store_game_board(board, raw, len, line_number);
                 line_number++;
-                
             }
+            continue;
+        }
+
+        char *start = line_cstr(&board->arena, small, sizeof(small), raw, len);
+        if (start == NULL) {
+            result = -1;
+
+        }else if(strncmp(start, "DIM ", 4) ==0){
+            char *rest = start + 4;
+            result = set_board_dim(rest, board);
+            
+        }else if(board->board == NULL){
+            fprintf(stderr, "level error: DIM must come before '%s'\n", start);
+            result = -1;
+
+        }else if(strncmp(start, "PAC ", 4) ==0){
+            has_pac = 1;
+            char *rest = start + 4;
+            result = prepare_and_read_pac_file(board, rest, points, path);
             
+
+        }else if(strncmp(start, "MON ", 4) ==0){
+            char *rest = start +4;
+            //counting how many monsters there will be
+            result = set_memory_for_ghosts(board, rest);
+            if (result == 0)
+                result = prepare_and_read_mon_file(board, rest, path);
+
+        }else if(strncmp(start, "TEMPO ", 6) ==0){
+            char *rest = start + 6;
+            int tempo;
+            sscanf(rest, "%d", &tempo);
+            board->tempo =tempo;
         }
-        if (end == NULL)
-            break; 
-        start = end + 1; // move to the next line
     }
-    if(has_pac ==0){
-        load_pacman_for_player(board, points);
+    close_view(&view);
+    if (result != 0) {
+        return -1;
     }
-    free(buffer);
-    
+    if(has_pac ==0 && load_pacman_for_player(board, points) ==-1){
+        return -1;
+    }
+    seed_agents(board);
+    return build_level_tables(board);
+}
 
+int build_level_tables(board_t* board) {
+    int width = board->width;
+    int height = board->height;
+    size_t cells = (size_t)width * height;
+    board->row_words = (width + 63) / 64;
+    board->col_words = (height + 63) / 64;
+    size_t row_bits = (size_t)height * board->row_words;
+    size_t col_bits = (size_t)width * board->col_words;
+    // one arena chunk for the four bitmaps, 2 bits per position each way, they come zeroed
+    uint64_t* bits = arena_alloc(&board->arena, 2 * (row_bits + col_bits) * sizeof(uint64_t));
+    int slots = 8;
+    while (slots < 2 * (board->n_ghosts + board->n_pacmans)) slots *= 2;
+    board->agents = arena_alloc(&board->arena, slots * sizeof(agent_slot_t));
+    board->agents_mask = slots - 1;
+    // a tick changes the positions an agent leaves and enters, plus the ones it marks charged
+    size_t dirty = 4 * (size_t)(board->n_ghosts + board->n_pacmans);
+    if (dirty < DIRTY_MIN) dirty = DIRTY_MIN;
+    if (dirty > cells) dirty = cells;
+    board->dirty_capacity = (int)dirty;
+    board->dirty = arena_alloc(&board->arena, dirty * sizeof(int));
+    if (!bits || !board->agents || !board->dirty) {
+        board->row_agents = NULL;
+        return -1;
+    }
+    board->row_walls = bits;
+    board->col_walls = bits + row_bits;
+    board->row_agents = bits + row_bits + col_bits;
+    board->col_agents = bits + 2 * row_bits + col_bits;
+
+    // walls never move, the bitmaps are only written here
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (board_content(board, get_board_index(board, x, y)) == 'W') {
+                board->row_walls[(size_t)y * board->row_words + (x >> 6)] |= 1ULL << (x & 63);
+                board->col_walls[(size_t)x * board->col_words + (y >> 6)] |= 1ULL << (y & 63);
+            }
+        }
+    }
+
+    board_index_agents(board);
     return 0;
 }
 
-void unload_level(board_t * board) {
-    free(board->board);
-    free(board->pacmans);
-    free(board->ghosts);
-}
+void board_index_agents(board_t* board) {
+    size_t cells = (size_t)board->width * board->height;
+    memset(board->row_agents, 0, (size_t)board->height * board->row_words * sizeof(uint64_t));
+    memset(board->col_agents, 0, (size_t)board->width * board->col_words * sizeof(uint64_t));
+    for (size_t i = 0; i < cells; i++) {
+        // dirty bits may come from a compiled level or a snapshot, the next draw repaints everything
+        board->board[i] &= ~CELL_DIRTY;
+        if ((board->board[i] & CELL_CONTENT_MASK) >= CELL_PACMAN) {
+            board_mark_agent(board, i, 1);
+        }
+    }
+    board->n_dirty = 0;
+    board->full_redraw = 1;
 
-void open_debug_file(char *filename) {
-    debugfile = fopen(filename, "w");
+    for (int s = 0; s <= board->agents_mask; s++) {
+        board->agents[s].position = -1;
+    }
+    for (int g = 0; g < board->n_ghosts; g++) {
+        board_set_agent(board, get_board_index(board, board->ghosts[g].pos_x, board->ghosts[g].pos_y), g);
+    }
+    for (int p = 0; p < board->n_pacmans; p++) {
+        if (board->pacmans[p].alive) {
+            board_set_agent(board, get_board_index(board, board->pacmans[p].pos_x, board->pacmans[p].pos_y), PACMAN_AGENT(p));
+        }
+    }
 }
 
-void close_debug_file() {
-    fclose(debugfile);
+void board_mark_agent(board_t* board, int index, int present) {
+    if (!board->row_agents) return; // tables are not built yet while loading
+    int x = index % board->width;
+    int y = index / board->width;
+    uint64_t* row = &board->row_agents[(size_t)y * board->row_words + (x >> 6)];
+    uint64_t* col = &board->col_agents[(size_t)x * board->col_words + (y >> 6)];
+    if (present) {
+        *row |= 1ULL << (x & 63);
+        *col |= 1ULL << (y & 63);
+    } else {
+        *row &= ~(1ULL << (x & 63));
+        *col &= ~(1ULL << (y & 63));
+    }
 }
 
-void debug(const char * format, ...) {
-    va_list args;
-    va_start(args, format);
-    vfprintf(debugfile, format, args);
-    va_end(args);
+// Helper private function, first slot to look at for a position
+static inline int agent_slot(const board_t* board, int index) {
+    uint32_t hash = (uint32_t)index * 2654435761u;
+    return (int)((hash ^ (hash >> 16)) & board->agents_mask);
+}
 
-    fflush(debugfile);
+int board_agent_at(const board_t* board, int index) {
+    for (int s = agent_slot(board, index);; s = (s + 1) & board->agents_mask) {
+        if (board->agents[s].position == index) return board->agents[s].agent;
+        if (board->agents[s].position < 0) return NO_AGENT;
+    }
 }
 
-void print_board(board_t *board) {
-    if (!board || !board->board) {
-        debug("[%d] Board is empty or not initialized.\n", getpid());
+void board_set_agent(board_t* board, int index, int agent) {
+    int s = agent_slot(board, index);
+    while (board->agents[s].position >= 0 && board->agents[s].position != index) {
+        s = (s + 1) & board->agents_mask;
+    }
+    if (agent != NO_AGENT) {
+        board->agents[s].position = index;
+        board->agents[s].agent = agent;
         return;
     }
+    if (board->agents[s].position < 0) return; // nothing was there
+    // removing, the entries after the hole that probed past it are moved back so no lookup stops early
+    board->agents[s].position = -1;
+    for (int next = (s + 1) & board->agents_mask; board->agents[next].position >= 0; next = (next + 1) & board->agents_mask) {
+        int home = agent_slot(board, board->agents[next].position);
+        // next can fill the hole unless its home lies after the hole, within (s, next]
+        int stays = (s <= next) ? (s < home && home <= next) : (s < home || home <= next);
+        if (!stays) {
+            board->agents[s] = board->agents[next];
+            board->agents[next].position = -1;
+            s = next;
+        }
+    }
+}
 
-    // Large buffer to accumulate the whole output
-    char buffer[8192];
-    size_t offset = 0;
-
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                       "=== [%d] LEVEL INFO ===\n"
-                       "Dimensions: %d x %d\n"
-                       "Tempo: %d\n"
-                       "Pacman file: %s\n",
-                       getpid(), board->height, board->width, board->tempo, board->pacman_file);
+void unload_level(board_t * board) {
+    debug("ARENA %s allocs=%zu bytes=%zu reserved=%zu\n", board->level_name,
+          board->arena.allocs, board->arena.bytes, board->arena.reserved);
+    arena_reset(&board->arena);
+}
 
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                       "Monster files (%d):\n", board->n_ghosts);
+// fixed part of the copy print_board logs, followed by the file names, each NUL terminated, and the positions
+typedef struct {
+    int32_t pid, width, height, tempo, n_ghosts;
+} board_snapshot_t;
 
-    for (int i = 0; i < board->n_ghosts; i++) {
-        offset += snprintf(buffer + offset, sizeof(buffer) - offset,
-                           "  - %s\n", board->ghosts_files[i]);
+// Helper private function, turns the copy made by print_board into text, runs on the log writer thread
+static void format_board(FILE *file, const void *data, size_t size) {
+    board_snapshot_t snap;
+    if (size < sizeof(snap)) {
+        return;
+    }
+    memcpy(&snap, data, sizeof(snap));
+    const char *names = (const char *)data + sizeof(snap);
+
+    fprintf(file, "=== [%d] LEVEL INFO ===\n"
+                  "Dimensions: %d x %d\n"
+                  "Tempo: %d\n"
+                  "Pacman file: %s\n",
+                  snap.pid, snap.height, snap.width, snap.tempo, names);
+    names += strlen(names) + 1;
+
+    fprintf(file, "Monster files (%d):\n", snap.n_ghosts);
+    for (int i = 0; i < snap.n_ghosts; i++) {
+        fprintf(file, "  - %s\n", names);
+        names += strlen(names) + 1;
     }
 
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "\n=== BOARD ===\n");
-
-    for (int y = 0; y < board->height; y++) {
-        for (int x = 0; x < board->width; x++) {
-            int idx = y * board->width + x;
-            if (offset < sizeof(buffer) - 2) {
-                buffer[offset++] = board->board[idx].content;
-            }
-        }
-        if (offset < sizeof(buffer) - 2) {
-            buffer[offset++] = '\n';
+    fprintf(file, "\n=== BOARD ===\n");
+    static const char contents[] = {' ', 'W', 'P', 'M'};
+    const board_pos_t *cells = (const board_pos_t *)names;
+    for (int y = 0; y < snap.height; y++) {
+        for (int x = 0; x < snap.width; x++) {
+            fputc(contents[cells[y * snap.width + x] & CELL_CONTENT_MASK], file);
         }
+        fputc('\n', file);
     }
+    fprintf(file, "==================\n");
+}
 
-    offset += snprintf(buffer + offset, sizeof(buffer) - offset, "==================\n");
-
-    buffer[offset] = '\0';
+void print_board(board_t *board) {
+    if (LOG_LEVEL < LOG_LEVEL_DEBUG) {
+        return;
+    }
+    if (!board || !board->board) {
+        debug("[%d] Board is empty or not initialized.\n", getpid());
+        return;
+    }
 
-    debug("%s", buffer);
+    // the game thread only copies, the text is made by the log writer
+    board_snapshot_t snap = {getpid(), board->width, board->height, board->tempo, board->n_ghosts};
+    int n_parts = board->n_ghosts + 3;
+    log_part_t *parts = malloc(n_parts * sizeof(log_part_t));
+    if (parts == NULL) {
+        return;
+    }
+    parts[0] = (log_part_t){&snap, sizeof(snap)};
+    parts[1] = (log_part_t){board->pacman_file, strlen(board->pacman_file) + 1};
+    for (int i = 0; i < board->n_ghosts; i++) {
+        const char *name = board->ghosts_files[i] ? board->ghosts_files[i] : "";
+        parts[2 + i] = (log_part_t){name, strlen(name) + 1};
+    }
+    parts[n_parts - 1] = (log_part_t){board->board, (size_t)board->width * board->height * sizeof(board_pos_t)};
+    log_binary(LOG_LEVEL_DEBUG, format_board, parts, n_parts);
+    free(parts);
 }
@@ -23,6 +23,9 @@ int terminal_init() {
     // Hide the cursor
     curs_set(0);
 
+    // Keys are read from stdin by the input thread, refresh() must not peek at it
+    typeahead(-1);
+
     // Enable color if terminal supports it
     if (has_colors()) {
         start_color();
@@ -44,96 +47,96 @@ int terminal_init() {
 }
 
 
-void draw_board(board_t* board, int mode) {
-    // Clear the screen before redrawing
-    clear();
+// Starting row for the game board (leave space for UI)
+#define BOARD_START_ROW 3
 
-    // Draw the border/title
-    attron(COLOR_PAIR(5));
-    mvprintw(0, 0, "=== PACMAN GAME ===");
-    switch(mode) {
-    case DRAW_GAME_OVER:
-        mvprintw(1, 0, " GAME OVER ");
-        break;
-
-    case DRAW_WIN:
-        mvprintw(1, 0, " VICTORY ");
-        break;
-
-    case DRAW_MENU:
-        mvprintw(1, 0, "Level: %s | Use W/A/S/D to move | Q to quit | G to quicksave ", board->level_name);
-        break;
-    }
+// Helper private function, draws one position, every attribute it uses is set here
+static void draw_cell(frame_t* frame, int index) {
+    board_pos_t cell = frame->cells[index];
 
+    // Move cursor to position
+    move(BOARD_START_ROW + index / frame->width, index % frame->width);
 
-    // Starting row for the game board (leave space for UI)
-    int start_row = 3;
+    // Draw with appropriate color
+    switch (cell & CELL_CONTENT_MASK) {
+        case CELL_WALL: // Wall
+            attrset(COLOR_PAIR(3));
+            addch('#');
+            break;
 
-    // Draw the board
-    for (int y = 0; y < board->height; y++) {
-        for (int x = 0; x < board->width; x++) {
-            int index = y * board->width + x;
-            char ch = board->board[index].content;
-            int ghost_charged = 0;
+        case CELL_PACMAN: // Pacman
+            attrset(COLOR_PAIR(1) | A_BOLD);
+            addch('C');
+            break;
 
-            for (int g = 0; g < board->n_ghosts; g++) {
-                ghost_t* ghost = &board->ghosts[g];
-                if (ghost->pos_x == x && ghost->pos_y == y) {
-                    if (ghost->charged)
-                        ghost_charged = 1;
-                    break;
-                }
-            }
+        case CELL_GHOST: // Monster/Ghost
+            attrset((COLOR_PAIR(2) | A_BOLD) | ((cell & FRAME_CHARGED) ? (A_DIM) : (0)));
+            addch('M');
+            break;
 
-            // Move cursor to position
-            move(start_row + y, x);
-
-            // Draw with appropriate color
-            switch (ch) {
-                case 'W': // Wall
-                    attron(COLOR_PAIR(3));
-                    addch('#');
-                    attroff(COLOR_PAIR(3));
-                    break;
-
-                case 'P': // Pacman
-                    attron(COLOR_PAIR(1) | A_BOLD);
-                    addch('C');
-                    attroff(COLOR_PAIR(1) | A_BOLD);
-                    break;
-
-                case 'M': // Monster/Ghost
-                    attron((COLOR_PAIR(2) | A_BOLD) | ((ghost_charged) ? (A_DIM) : (0)));
-                    addch('M');
-                    attroff((COLOR_PAIR(2) | A_BOLD) | ((ghost_charged) ? (A_DIM) : (0)));
-                    break;
-
-                case ' ': // Empty space
-                    if (board->board[index].has_portal) {
-                        attron(COLOR_PAIR(6));
-                        addch('@');
-                        attroff(COLOR_PAIR(6));
-                    }
-                    else if (board->board[index].has_dot) {
-                        attron(COLOR_PAIR(4));
-                        addch('.');
-                        attroff(COLOR_PAIR(4));
-                    }
-                    else
-                        addch(' ');
-                    break;
-
-                default:
-                    addch(ch);
-                    break;
+        default: // Empty space
+            if (cell & CELL_PORTAL) {
+                attrset(COLOR_PAIR(6));
+                addch('@');
             }
+            else if (cell & CELL_DOT) {
+                attrset(COLOR_PAIR(4));
+                addch('.');
+            }
+            else {
+                attrset(A_NORMAL);
+                addch(' ');
+            }
+            break;
+    }
+    attrset(A_NORMAL);
+}
+
+void draw_frame(frame_t* frame) {
+    // mode shown on the status line, -1 when the screen was cleared
+    static int shown_mode = -1;
+
+    // only the positions changed since the last draw are sent, unless the whole screen is stale
+    if (frame->full_redraw) {
+        clear();
+        shown_mode = -1;
+        for (int index = 0; index < frame->width * frame->height; index++) {
+            draw_cell(frame, index);
         }
+        frame->full_redraw = 0;
     }
+    else {
+        for (int i = 0; i < frame->n_changed; i++) {
+            draw_cell(frame, frame->changed[i]);
+        }
+    }
+    frame->n_changed = 0;
 
-    // Draw score/status at the bottom
+    // Draw the border/title
     attron(COLOR_PAIR(5));
-    mvprintw(start_row + board->height + 1, 0, "Points: %d",
-             board->pacmans[0].points); // Assuming first pacman for now
+    if (shown_mode != frame->mode) {
+        mvprintw(0, 0, "=== PACMAN GAME ===");
+        move(1, 0);
+        clrtoeol();
+        switch(frame->mode) {
+        case DRAW_GAME_OVER:
+            mvprintw(1, 0, " GAME OVER ");
+            break;
+
+        case DRAW_WIN:
+            mvprintw(1, 0, " VICTORY ");
+            break;
+
+        case DRAW_MENU:
+            mvprintw(1, 0, "Level: %s | Use W/A/S/D to move | Q to quit | G to quicksave ", frame->level_name);
+            break;
+        }
+        shown_mode = frame->mode;
+    }
+
+    // Draw score/status at the bottom
+    mvprintw(BOARD_START_ROW + frame->height + 1, 0, "Points: %d", frame->points);
+    clrtoeol();
     attroff(COLOR_PAIR(5));
 }
 
@@ -158,7 +161,15 @@ char get_input() {
         return '\0'; // No input
     }
 
-    ch = toupper((char)ch);
+    return key_command(ch);
+}
+
+char key_command(int ch) {
+    if (ch < 0 || ch > 0xff) {
+        return '\0'; // Special keys
+    }
+
+    ch = toupper(ch);
 
     switch ((char)ch) {
         case 'W':
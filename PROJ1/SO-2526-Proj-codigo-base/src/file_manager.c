@@ -5,52 +5,154 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-char *read_file(int fd){
-    int stride = 128;
-    char *buffer = malloc(stride* sizeof(char));
-    if (!buffer) return NULL;
-    int buf_free = stride;
-    int buf_total = stride;
-    int buf_bytes_written =0;
-
-    /* read the contents of the file */
-    int bytes_read =1;
-    int done = 0;
-    while (bytes_read !=0) {
-        if(buf_free < stride){
-            buffer = realloc(buffer, buf_total +stride);
-            buf_free += stride;
-            buf_total += stride;
-            if(buffer == NULL){
-                free(buffer);
-                return 0;
+char *read_file(int fd, arena_t *arena, size_t size_hint, size_t *size){
+    //a regular file is read in one go, a pipe keeps doubling
+    size_t capacity = size_hint > 0 ? size_hint +1 : 4096;
+    size_t done = 0;
+    char *buffer = arena_alloc(arena, capacity);
+    if(buffer == NULL){
+        return NULL;
+    }
+    while(1){
+        if(done +1 >= capacity){
+            //a full buffer is most often the whole file, one byte read tells before anything is grown
+            char probe;
+            ssize_t probed = read(fd, &probe, 1);
+            if(probed < 0){
+                perror("read error");
+                return NULL;
+            }
+            if(probed == 0){
+                break;
             }
+            //doubles into a new chunk, the old one is dropped with the rest of the arena
+            char *bigger = arena_alloc(arena, capacity * 2);
+            if(bigger == NULL){
+                return NULL;
+            }
+            memcpy(bigger, buffer, done);
+            buffer = bigger;
+            capacity *= 2;
+            buffer[done++] = probe;
         }
-
-        bytes_read = read(fd, buffer + done, stride);
-
-        if (bytes_read < 0) {
+        ssize_t bytes_read = read(fd, buffer + done, capacity - done -1);
+        if(bytes_read < 0){
             perror("read error");
             return NULL;
         }
-
-        /* if we read 0 bytes, we're done */
-        if (bytes_read == 0) {
+        if(bytes_read == 0){
             break;
         }
-
-        
         done += bytes_read;
-        buf_free -= bytes_read;
-        buf_bytes_written += bytes_read;
     }
     buffer[done] = '\0';
+    *size = done;
     return buffer;
 }
 
+int open_view(int fd, arena_t *arena, file_view_t *view){
+    struct stat st;
+    view->map = NULL;
+    view->map_size = 0;
+    if(fstat(fd, &st) ==-1){
+        perror("fstat");
+        return -1;
+    }
+    if(S_ISREG(st.st_mode) && st.st_size > 0){
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map != MAP_FAILED){
+            posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            view->map = map;
+            view->map_size = st.st_size;
+            view->data = map;
+            view->size = st.st_size;
+            return 0;
+        }
+        //some file systems can not be mapped, read it instead
+    }
+    size_t hint = S_ISREG(st.st_mode) ? (size_t)st.st_size : 0;
+    view->data = read_file(fd, arena, hint, &view->size);
+    return view->data == NULL ? -1 : 0;
+}
+
+void close_view(file_view_t *view){
+    if(view->map != NULL){
+        munmap(view->map, view->map_size);
+        view->map = NULL;
+    }
+}
+
+int view_next_line(const file_view_t *view, size_t *cursor, const char **line, size_t *len){
+    if(*cursor >= view->size){
+        return 0;
+    }
+    const char *start = view->data + *cursor;
+    const char *end = memchr(start, '\n', view->size - *cursor);
+    size_t line_len = end != NULL ? (size_t)(end - start) : view->size - *cursor;
+    *cursor += line_len +1;
+    if(line_len > 0 && start[line_len -1] == '\r'){
+        line_len--;
+    }
+    *line = start;
+    *len = line_len;
+    return 1;
+}
+
+int view_count_lines(const file_view_t *view){
+    int lines = 1;
+    const char *c = view->data;
+    const char *end = view->data + view->size;
+    while((c = memchr(c, '\n', end - c)) != NULL){
+        lines++;
+        c++;
+    }
+    return lines;
+}
+
+char *line_cstr(arena_t *arena, char *small, size_t cap, const char *line, size_t len){
+    char *copy = len < cap ? small : arena_alloc(arena, len +1);
+    if(copy == NULL){
+        return NULL;
+    }
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+const void *view_take(view_reader_t *r, size_t size){
+    if(r->error || size > r->view->size - r->off){
+        r->error = 1;
+        return NULL;
+    }
+    const void *ptr = r->view->data + r->off;
+    r->off += size;
+    return ptr;
+}
+
+int32_t view_take_i32(view_reader_t *r){
+    int32_t value = 0;
+    const void *ptr = view_take(r, sizeof(value));
+    if(ptr != NULL){
+        memcpy(&value, ptr, sizeof(value));
+    }
+    return value;
+}
+
+int line_has_prefix(const char *line, size_t len, const char *prefix){
+    size_t prefix_len = strlen(prefix);
+    return len >= prefix_len && memcmp(line, prefix, prefix_len) == 0;
+}
+
+int is_lvlb_file(const char *file){
+    size_t len = strlen(file);
+    return len >= 5 && strcmp(file + len - 5, ".lvlb") == 0;
+}
 
 int is_lvl_file(char *file){
+    if (is_lvlb_file(file)) return 1; //compiled by lvlc
     size_t len = strlen(file);
     if (len < 4) return 0;
     return strcmp(file + len - 4, ".lvl") == 0;
@@ -117,108 +219,147 @@ char **get_lvl_files(char *inputdir, int *count){
 }
 
 
-void set_board_dim(char *dim, board_t *board){
+int set_board_dim(char *dim, board_t *board){
     int width, height;
-    sscanf(dim, "%d %d", &width, &height);
+    if(sscanf(dim, "%d %d", &width, &height) != 2 || width <= 0 || height <= 0){
+        fprintf(stderr, "level error: bad DIM '%s'\n", dim);
+        return -1;
+    }
     board->width = width;
     board->height = height;
-    board->board = calloc(board->width * board->height, sizeof(board_pos_t));
+    board->board = arena_alloc(&board->arena, (size_t)board->width * board->height * sizeof(board_pos_t));
+    return board->board == NULL ? -1 : 0;
 }
 
-void prepare_and_read_pac_file(board_t *board, char *line, int points, char *dirpath){
+int prepare_and_read_pac_file(board_t *board, char *line, int points, char *dirpath){
     snprintf(board->pacman_file, sizeof(board->pacman_file), "%s", line);
     int pacman_count =1;
     board->n_pacmans = pacman_count;
-    board->pacmans = calloc(board->n_pacmans, sizeof(pacman_t));
-    char pac_path[128];
+    board->pacmans = arena_alloc(&board->arena, board->n_pacmans * sizeof(pacman_t));
+    if(board->pacmans == NULL){
+        return -1;
+    }
+    char pac_path[2 * MAX_FILENAME];
     snprintf(pac_path, sizeof(pac_path), "%s/%s", dirpath, line);
     int fd = open(pac_path, O_RDONLY);
     if (fd < 0) {
         perror("open");
-        return;
+        return -1;
     }
-    load_pacman(board, fd, points);
+    int result = load_pacman(board, fd, points);
     close(fd);
+    return result;
 }
 
-void set_memory_for_ghosts(board_t *board, char *mon_files){
-    int ghost_count = 1;
+int set_memory_for_ghosts(board_t *board, char *mon_files){
+    //counts the names the same way strtok will split them
+    int ghost_count = 0;
     for (int j = 0; mon_files[j] != '\0'; j++) {
-        if (mon_files[j] == ' '){
+        if (mon_files[j] != ' ' && (j == 0 || mon_files[j - 1] == ' ')){
             ghost_count++;
         }
     }
     board->n_ghosts = ghost_count;
-    board->ghosts = calloc(board->n_ghosts, sizeof(ghost_t));
+    board->ghosts = arena_alloc(&board->arena, board->n_ghosts * sizeof(ghost_t));
+    board->ghosts_files = arena_alloc(&board->arena, board->n_ghosts * sizeof(char *));
+    if (board->n_ghosts > 0 && (board->ghosts == NULL || board->ghosts_files == NULL)) {
+        fprintf(stderr, "level error: out of memory for %d ghosts\n", board->n_ghosts);
+        return -1;
+    }
+    return 0;
 }
 
-void prepare_and_read_mon_file(board_t *board, char *mon_files, char *dirpath){
+int prepare_and_read_mon_file(board_t *board, char *mon_files, char *dirpath){
     int ghost_index =0;
     char *mon_file = strtok(mon_files, " ");
 
-    while(mon_file != NULL){
-        snprintf(board->ghosts_files[ghost_index], sizeof(board->ghosts_files[ghost_index]), "%s", mon_file);
-        char mon_path[128];
+    while(mon_file != NULL && ghost_index < board->n_ghosts){
+        board->ghosts_files[ghost_index] = arena_strdup(&board->arena, mon_file);
+        char mon_path[2 * MAX_FILENAME];
         snprintf(mon_path, sizeof(mon_path), "%s/%s", dirpath, mon_file);
         int fd = open(mon_path, O_RDONLY);
         if (fd < 0) {
             perror("open");
-            return;
+            return -1;
         }
-        load_ghost(board, fd, ghost_index);
+        int result = load_ghost(board, fd, ghost_index);
         mon_file = strtok(NULL, " ");
         close(fd);
+        if (result != 0) {
+            return -1;
+        }
         ghost_index++;
     }
+    return 0;
 }
 
-void store_game_board(board_t *board, char *line, int line_number){
+int store_game_board(board_t *board, const char *line, size_t len, int line_number){
+    if (line_number >= board->height || len > (size_t)board->width) {
+        fprintf(stderr, "level error: board line %d '%.*s' does not fit the %dx%d board\n",
+                line_number, (int)len, line, board->width, board->height);
+        return -1;
+    }
     char c;
-    for (int i = 0; line[i] != '\0'; i++) {
+    for (int i = 0; i < (int)len; i++) {
         c = line[i];
-        char current =board->board[board->width*line_number + i].content;
+        char current =board_content(board, board->width*line_number + i);
         if(current != 'P' && current != 'M'){
             if(c =='X'){
-                board->board[board->width*line_number + i].content = 'W';
+                board_set_content(board, board->width*line_number + i, 'W');
             }else if(c == 'o'){
-                board->board[board->width*line_number + i].content = ' ';
-                board->board[board->width*line_number + i].has_dot = 1;
+                board_set_content(board, board->width*line_number + i, ' ');
+                board_set_dot(board, board->width*line_number + i, 1);
             }else if(c == '@'){
-                board->board[board->width*line_number + i].content = ' ';
-                board->board[board->width*line_number + i].has_portal = 1;
+                board_set_content(board, board->width*line_number + i, ' ');
+                board_set_portal(board, board->width*line_number + i, 1);
             }
         }else{
-            board->board[board->width*line_number + i].has_dot = 1;
+            board_set_dot(board, board->width*line_number + i, 1);
         }   
     }
+    return 0;
 }
 
-void load_pacman_for_player(board_t *board, int points){
-    board->pacmans = calloc(board->n_pacmans, sizeof(pacman_t));
+int load_pacman_for_player(board_t *board, int points){
     int pacman_count =1;
     board->n_pacmans = pacman_count;
+    board->pacmans = arena_alloc(&board->arena, board->n_pacmans * sizeof(pacman_t));
+    if(board->pacmans == NULL){
+        return -1;
+    }
     board->pacmans[0].n_moves = 0;
     board->pacmans[0].alive =1;
     board->pacmans[0].points = points;
     for(int i =0; i<board->width * board->height; i++){
-        if(board->board[i].content == ' ' && board->board[i].has_portal !=1){
+        if(board_content(board, i) == ' ' && board_has_portal(board, i) !=1){
             int pos_y = i / board->width;
             int pos_x = i % board->width;
             board->pacmans[0].pos_x = pos_x;
             board->pacmans[0].pos_y = pos_y;
-            board->board[pos_y * board->width + pos_x].content = 'P';
+            board_set_content(board, pos_y * board->width + pos_x, 'P');
             break;
         }
     }
+    return 0;
 }
 
 
-void store_pac_pos(board_t *board, char *linePos){
+//checks a POS line against the board before anything is written
+static int read_pos(board_t *board, char *linePos, int *X, int *Y){
+    if(sscanf(linePos, "%d %d", X, Y) != 2 || *X < 0 || *X >= board->width || *Y < 0 || *Y >= board->height){
+        fprintf(stderr, "level error: POS '%s' outside the %dx%d board\n", linePos, board->width, board->height);
+        return -1;
+    }
+    return 0;
+}
+
+int store_pac_pos(board_t *board, char *linePos){
     int X, Y;
-    sscanf(linePos, "%d %d", &X, &Y);
+    if(read_pos(board, linePos, &X, &Y) != 0) return -1;
     board->pacmans[0].pos_x = X;
     board->pacmans[0].pos_y = Y;
-    board->board[Y * board->width + X].content = 'P';
+    board_set_content(board, Y * board->width + X, 'P');
+    return 0;
 }
 
 void store_pac_passo(board_t *board, char *linePasso){
@@ -249,12 +390,13 @@ void store_pac_moves(board_t *board, char *command, int move_index){
 }
 
 
-void store_mon_pos(board_t *board, int ghost_index, char *linePos){
+int store_mon_pos(board_t *board, int ghost_index, char *linePos){
     int X, Y;
-    sscanf(linePos, "%d %d", &X, &Y);
+    if(read_pos(board, linePos, &X, &Y) != 0) return -1;
     board->ghosts[ghost_index].pos_x = X;
     board->ghosts[ghost_index].pos_y = Y;
-    board->board[Y * board->width + X].content = 'M'; // Monster
+    board_set_content(board, Y * board->width + X, 'M'); // Monster
+    return 0;
 }
 
 void store_mon_passo(board_t *board, int ghost_index, char *linePasso){
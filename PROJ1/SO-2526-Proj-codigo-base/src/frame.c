@@ -0,0 +1,113 @@
+#include "frame.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+void frame_init(frame_t *frame){
+    memset(frame, 0, sizeof(*frame));
+}
+
+void frame_free(frame_t *frame){
+    free(frame->cells);
+    free(frame->changed);
+    frame_init(frame);
+}
+
+//grows the arrays of the frame to hold cells positions and changed changes, returns -1 if out of memory
+static int frame_reserve(frame_t *frame, int cells, int changed){
+    if(cells > frame->capacity){
+        board_pos_t *grown_cells = realloc(frame->cells, cells * sizeof(board_pos_t));
+        if(grown_cells == NULL){
+            return -1;
+        }
+        frame->cells = grown_cells;
+        frame->capacity = cells;
+    }
+    if(changed > frame->changed_capacity){
+        int *grown_changed = realloc(frame->changed, changed * sizeof(int));
+        if(grown_changed == NULL){
+            return -1;
+        }
+        frame->changed = grown_changed;
+        frame->changed_capacity = changed;
+    }
+    return 0;
+}
+
+board_pos_t frame_cell(const board_t *board, int index){
+    board_pos_t cell = board->board[index] & ~CELL_DIRTY;
+    int agent = board_agent_at(board, index);
+    if((cell & CELL_CONTENT_MASK) == CELL_GHOST && agent >= 0 && board->ghosts[agent].charged){
+        cell |= FRAME_CHARGED;
+    }
+    return cell;
+}
+
+int frame_publish(frame_t *frame, board_t *board, int mode){
+    int cells = board->width * board->height;
+    if(board->full_redraw){
+        if(frame_reserve(frame, cells, board->dirty_capacity) == -1){
+            return -1;
+        }
+        //positions past a full dirty list are marked but not listed, every mark is cleared here
+        for(int index = 0; index < cells; index++){
+            board->board[index] &= ~CELL_DIRTY;
+            frame->cells[index] = frame_cell(board, index);
+        }
+        frame->width = board->width;
+        frame->height = board->height;
+        frame->n_changed = 0;
+        frame->full_redraw = 1;
+        board->full_redraw = 0;
+    }else{
+        //a position changed again before the render thread took it is only listed once
+        for(int i = 0; i < board->n_dirty; i++){
+            int index = board->dirty[i];
+            board->board[index] &= ~CELL_DIRTY;
+            if(!(frame->cells[index] & CELL_DIRTY)){
+                //ticks published faster than they are drawn can outgrow the list, then the whole frame is drawn
+                if(frame->n_changed < frame->changed_capacity){
+                    frame->changed[frame->n_changed++] = index;
+                }else{
+                    frame->full_redraw = 1;
+                }
+            }
+            frame->cells[index] = frame_cell(board, index) | CELL_DIRTY;
+        }
+    }
+    board->n_dirty = 0;
+    frame->mode = mode;
+    frame->points = board->pacmans[0].points; // Assuming first pacman for now
+    snprintf(frame->level_name, sizeof(frame->level_name), "%s", board->level_name);
+    return 0;
+}
+
+int frame_take(frame_t *to, frame_t *from){
+    if(frame_reserve(to, from->capacity, from->changed_capacity) == -1){
+        return -1;
+    }
+    //published positions carry CELL_DIRTY while they are in its changed list
+    if(from->full_redraw){
+        for(int index = 0; index < from->width * from->height; index++){
+            from->cells[index] &= ~CELL_DIRTY;
+            to->cells[index] = from->cells[index];
+        }
+        to->full_redraw = 1;
+        to->n_changed = 0;
+        from->full_redraw = 0;
+    }else{
+        for(int i = 0; i < from->n_changed; i++){
+            int index = from->changed[i];
+            from->cells[index] &= ~CELL_DIRTY;
+            to->cells[index] = from->cells[index];
+            to->changed[to->n_changed++] = index;
+        }
+    }
+    from->n_changed = 0;
+    to->width = from->width;
+    to->height = from->height;
+    to->mode = from->mode;
+    to->points = from->points;
+    memcpy(to->level_name, from->level_name, sizeof(to->level_name));
+    return 0;
+}
@@ -1,6 +1,13 @@
 #include "board.h"
 #include "display.h"
+#include "render.h"
+#include "input.h"
 #include "file_manager.h"
+#include "ghost_pool.h"
+#include "level_loader.h"
+#include "snapshot.h"
+#include "savefile.h"
+#include "replay.h"
 #include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
@@ -19,28 +26,121 @@
 #define CREATE_BACKUP 4
 #define WON_GAME 5
 
+#define DEFAULT_MAX_TICKS 100000
 
-typedef struct{
-    board_t *board;
-    int ghost_index;
-} monster_thread_args;
+// how 'G' saves the game, see --save-mode
+#define SAVE_SNAPSHOT 0
+#define SAVE_FORK 1
+
+// set by --headless, no ncurses and no sleeps
+static int headless = 0;
+
+// set by --seed, every level seed is derived from it
+static uint64_t master_seed;
+
+// set by --save-mode, snapshots in memory by default, fork keeps the save in a waiting parent process
+static int save_mode = SAVE_SNAPSHOT;
+
+// set by --save-file, every quicksave is also written there
+static char *save_path = NULL;
+
+// set by --trace, a Chrome trace-event JSON of every thread and process is written there
+static char *trace_path = NULL;
+
+// set by --resume, play starts at the state saved in this file
+static char *resume_path = NULL;
+static int first_level = 0;
+
+// set by --record, every key taken and every level started is logged with its tick
+static char *record_path = NULL;
+
+// set by --replay, the keys come from a recorded log instead of the keyboard
+static char *replay_path = NULL;
+static replay_t replay;
+static int replay_stopped = 0;  // Q was typed while the replay was shown
+
+// play_board calls since the session started, what --record and --replay count ticks with
+static long session_ticks = 0;
+
+// set with --record and --replay, the ghosts move on the pacman loop instead of on their clock thread,
+// so the same keys at the same ticks always give the same game
+static int lockstep = 0;
+
+// draw the screen and read the keyboard on their own threads, unused in headless mode
+static renderer_t renderer;
+static input_t input;
+
+// the pacman loop on the level timeline, the ghost clock has its own pacer in the pool
+static tick_pacer_t pacman_pacer;
 
 
 void screen_refresh(board_t * game_board, int mode) {
-    debug("REFRESH\n");
-    draw_board(game_board, mode);
-    refresh_screen();
-    if(game_board->tempo != 0)
-        sleep_ms(game_board->tempo);       
+    debug_trace("REFRESH\n");
+    if(headless){
+        //an unthrottled replay, nothing is drawn and no tick is waited for
+        return;
+    }
+    renderer_publish(&renderer, game_board, mode);
+    if(game_board->tempo == 0 && game_board->pacmans[0].n_moves == 0 && replay_path == NULL){
+        //no tick to wait for, the player's next key is
+        trace_begin("wait input");
+        input_wait(&input, INPUT_IDLE_MS);
+        trace_end("wait input");
+        return;
+    }
+    tick_pacer_sleep(&pacman_pacer, &game_board->timeline);
+}
+
+// Helper private function, starts the level timeline with the ghost clock and the pacman both at tick 0
+static void start_ticks(ghost_pool_t *pool){
+    tick_pacer_restart(&pacman_pacer);
+    if(lockstep){
+        //the clock thread stays parked, the ghosts tick right after the pacman
+        tick_timeline_start(&pool->board->timeline, pool->board->tempo);
+        return;
+    }
+    ghost_pool_start(pool);
+}
+
+// Helper private function, logs a level start or the end of the session with --record, checks it against the log with --replay
+static void session_event(int type, int value){
+    if(record_path != NULL){
+        replay_record(&replay, session_ticks, type, value);
+    }else if(replay_path != NULL){
+        replay_check(&replay, session_ticks, type, value);
+    }
+}
+
+// Helper private function, logs how each side kept up with the timeline of the level and clears the metrics
+static void log_ticks(const char *level_name, ghost_pool_t *pool){
+    tick_pacer_t *pacers[2] = {&pacman_pacer, &pool->pacer};
+    const char *names[2] = {"pacman", "ghosts"};
+    //in lockstep the ghosts tick with the pacman and their clock never runs
+    for(int i =0; i <(lockstep ? 1 : 2); i++){
+        debug("TICKS %s %s ticks=%ld overruns=%ld skipped=%ld max_late=%ld us\n", level_name, names[i],
+              pacers[i]->ticks, pacers[i]->overruns, pacers[i]->skipped, pacers[i]->max_late_us);
+        tick_pacer_init(pacers[i]);
+    }
 }
 
 int play_board(board_t * game_board) {
     pacman_t* pacman = &game_board->pacmans[0];
     command_t* play;
     command_t c; 
+    session_ticks++;
     if (pacman->n_moves == 0) { // if is user input
         
-        c.command = get_input();
+        if(replay_path != NULL){
+            c.command = replay_key(&replay, session_ticks);
+            //Q on the keyboard stops a replay shown in the terminal
+            if(!headless && input_take(&input) == 'Q'){
+                c.command = 'Q';
+                replay_stopped = 1;
+            }
+        }else{
+            // there is no keyboard in headless mode, the player never presses a key and the ghosts play on
+            c.command = headless ? '\0' : input_take(&input);
+        }
 
         if(c.command == '\0'){
             if(game_board->pacmans[0].alive ==0){
@@ -50,6 +150,9 @@ int play_board(board_t * game_board) {
             }
         }
 
+        if(record_path != NULL){
+            replay_record(&replay, session_ticks, REPLAY_KEY, c.command);
+        }
         c.turns = 1;
         play = &c;
     }
@@ -59,7 +162,7 @@ int play_board(board_t * game_board) {
         play = &pacman->moves[pacman->current_move%pacman->n_moves];
     }
 
-    debug("KEY %c\n", play->command);
+    debug_trace("KEY %c\n", play->command);
 
     if (play->command == 'Q') {
         return QUIT_GAME;
@@ -72,9 +175,13 @@ int play_board(board_t * game_board) {
     }
 
 
-    pthread_mutex_lock(&game_board->lock);
+    board_lock(game_board);
+    trace_begin("pacman move");
+    stats_start(start);
     int result = move_pacman(game_board, 0, play);
-    pthread_mutex_unlock(&game_board->lock);
+    stats_stop(STAT_MOVE_PACMAN, start);
+    trace_end("pacman move");
+    board_unlock(game_board);
     if (result == REACHED_PORTAL) {
         // Next level
         return NEXT_LEVEL;
@@ -91,118 +198,369 @@ int play_board(board_t * game_board) {
     return CONTINUE_PLAY;  
 }
 
-void *monster_thread(void *arg){
-    monster_thread_args *monster = (monster_thread_args *)arg;
-
-    board_t *board = monster->board;
-    int ghost_index = monster->ghost_index;
-
-    ghost_t* ghost = &board->ghosts[ghost_index];
-    while(board->threads_live == 1){
-
-        pthread_mutex_lock(&board->lock);
-        move_ghost(board, ghost_index, &ghost->moves[ghost->current_move%ghost->n_moves]);
-        pthread_mutex_unlock(&board->lock);
-        if (!board->pacmans[0].alive) {
-            board->threads_live =0;
-            
-            break;
+//moves the pacman and then every ghost once, on the calling thread
+//'G' always takes a snapshot, forking would only copy this same loop into a child
+static int headless_tick(board_t *game_board, ghost_pool_t *pool, snapshot_store_t *saves, int level){
+    stats_start(start);
+    int result = play_board(game_board);
+    stats_stop(STAT_PLAY_BOARD, start);
+    if(result == CREATE_BACKUP){
+        if(snapshot_save(saves, QUICKSAVE_SLOT, game_board, level) ==-1){
+            perror("snapshot");
+        }else{
+            debug("SNAPSHOT SAVE %s\n", game_board->level_name);
         }
-        sleep_ms(board->tempo);
-        
+        result = CONTINUE_PLAY;
     }
-    free(monster);
-
-    return NULL;
-
+    if(result != CONTINUE_PLAY){
+        return result;
+    }
+    ghost_pool_tick(pool);
+    if(!game_board->pacmans[0].alive){
+        return QUIT_GAME;
+    }
+    return CONTINUE_PLAY;
 }
 
-
-int start_threads(pthread_t *tid, board_t *game_board){
-    for(int i =0; i <game_board->n_ghosts; i++){
-        monster_thread_args *args = malloc(sizeof(monster_thread_args));
-        args->board = game_board;
-        args->ghost_index = i;
-        if (pthread_create(&tid[i], NULL, monster_thread, args) != 0) {
-            fprintf(stderr, "error creating thread.\n");
-            return -1;
-        }
+// Helper private function, loads the level play starts at, the saved one when resuming
+static int load_first_level(board_t *board, char *level_dir, char **lvl_files){
+    if(resume_path != NULL){
+        return load_saved_level(resume_path, board);
     }
-    return 0;
+    return load_level_file(board, level_dir, lvl_files[0], rng_mix(master_seed, 0), 0);
 }
 
+// Helper private function, writes the quicksave to --save-file too, the ghosts must be stopped
+static void write_save_file(board_t *board, char *level_dir, char **lvl_files, int count, int level){
+    if(save_path == NULL){
+        return;
+    }
+    session_t session = {master_seed, "", lvl_files, count, level};
+    snprintf(session.level_dir, sizeof(session.level_dir), "%s", level_dir);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int saved = save_game(save_path, board, &session);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    debug("SAVE FILE %s %s %ld us\n", save_path, saved ==0 ? "ok" : "failed",
+          (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000);
+}
 
+// Helper private function, the prefetched level becomes the current one and the pacman keeps its points
+static void swap_boards(board_t **game_board, board_t **next_board, int points){
+    board_t *played = *game_board;
+    *game_board = *next_board;
+    *next_board = played;
+    (*game_board)->pacmans[0].points = points;
+}
 
+//plays every level driven by a logical tick counter and prints the outcome
+static int run_headless(char *dirpath, char **lvl_files, int count, long max_ticks){
+    board_t boards[2];
+    for(int b =0; b <2; b++){
+        pthread_mutex_init(&boards[b].lock, NULL);
+        arena_init(&boards[b].arena, ARENA_BLOCK_SIZE);
+        boards[b].on_save = 0;
+    }
+    board_t *game_board = &boards[0];
+    board_t *next_board = &boards[1];
+    level_loader_t loader;
+    level_loader_init(&loader);
+    ghost_pool_t pool;
+    if(ghost_pool_init(&pool, 0) ==-1){
+        return 1;
+    }
+    snapshot_store_t saves;
+    snapshot_store_init(&saves);
+    int rewind = 0; //1 when the quicksave to go back to is from an earlier level
+    int accumulated_points = 0;
+    long ticks = 0;
+    const char *outcome = "quit";
+    char level_name[256] = "";
 
+    if(load_first_level(game_board, dirpath, lvl_files) ==-1){
+        return 1;
+    }
+    accumulated_points = game_board->pacmans[0].points;
+    for(int level =first_level; level <count; level++){
+        snprintf(level_name, sizeof(level_name), "%s", lvl_files[level]);
+        //the next level is parsed while this one is played
+        int prefetching = level +1 < count;
+        if(prefetching){
+            level_loader_start(&loader, next_board, dirpath, lvl_files[level +1], rng_mix(master_seed, level +1));
+        }
+        ghost_pool_attach(&pool, game_board);
+
+        int result = CONTINUE_PLAY;
+        while(result == CONTINUE_PLAY && ticks < max_ticks){
+            result = headless_tick(game_board, &pool, &saves, level);
+            ticks++;
+            snapshot_t *quicksave = snapshot_find(&saves, QUICKSAVE_SLOT);
+            if(result == QUIT_GAME && !game_board->pacmans[0].alive && quicksave != NULL){
+                if(quicksave->level != level){
+                    rewind = 1;
+                    break;
+                }
+                //same level, only the state is copied back
+                if(snapshot_restore(quicksave, game_board) ==-1){
+                    break;
+                }
+                snapshot_drop(&saves, QUICKSAVE_SLOT);
+                debug("SNAPSHOT RESTORE %s\n", game_board->level_name);
+                result = CONTINUE_PLAY;
+            }
+        }
+        ghost_pool_detach(&pool);
+        stats_level_end(level_name, game_board->tempo);
+
+        accumulated_points = game_board->pacmans[0].points;
+        int alive = game_board->pacmans[0].alive;
+        print_board(game_board);
+        unload_level(game_board);
+        int prefetched = prefetching ? level_loader_wait(&loader) : -1;
+
+        if(rewind){
+            //the quicksave is from an earlier level, which is loaded again under the saved state
+            if(prefetched ==0){
+                unload_level(next_board);
+            }
+            snapshot_t *quicksave = snapshot_find(&saves, QUICKSAVE_SLOT);
+            if(load_level_file(game_board, dirpath, lvl_files[quicksave->level], rng_mix(master_seed, quicksave->level), 0) ==-1 ||
+               snapshot_restore(quicksave, game_board) ==-1){
+                return 1;
+            }
+            debug("SNAPSHOT RESTORE %s\n", game_board->level_name);
+            level = quicksave->level -1; //the loop moves on to the restored level
+            snapshot_drop(&saves, QUICKSAVE_SLOT);
+            rewind = 0;
+            continue;
+        }
+        if(result == NEXT_LEVEL){
+            if(level == count -1){
+                outcome = "win";
+            }else if(prefetched ==-1){
+                return 1;
+            }else{
+                swap_boards(&game_board, &next_board, accumulated_points);
+            }
+            continue;
+        }
+        if(prefetched ==0){
+            unload_level(next_board);
+        }
+        if(result == CONTINUE_PLAY){
+            outcome = "timeout";
+        }else{
+            outcome = alive ? "quit" : "lose";
+        }
+        break;
+    }
+    ghost_pool_destroy(&pool);
+    snapshot_store_free(&saves);
+    for(int b =0; b <2; b++){
+        arena_release(&boards[b].arena);
+        pthread_mutex_destroy(&boards[b].lock);
+    }
 
+    printf("outcome=%s points=%d ticks=%ld level=%s seed=%llu\n", outcome, accumulated_points, ticks, level_name,
+           (unsigned long long)master_seed);
+    return 0;
+}
 
+static void usage(char *prog){
+    printf("Usage: %s [--headless] [--max-ticks <n>] [--seed <n>] [--save-mode snapshot|fork] [--save-file <file>]\n"
+           "       [--record <file>] [--trace <file>] <level_directory> | --resume <file>\n"
+           "       %s [--headless] [--trace <file>] --replay <file>\n", prog, prog);
+}
 
+// Helper private function, stops the render and input threads and gives the terminal back
+static void leave_terminal(void){
+    input_stop(&input);
+    renderer_stop(&renderer);
+    if(!headless){
+        terminal_cleanup();
+    }
+}
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        printf("Usage: %s <level_directory>\n", argv[0]);
+    char *level_dir = NULL;
+    long max_ticks = DEFAULT_MAX_TICKS;
+    // Random seed for any random movements
+    master_seed = (uint64_t)time(NULL);
+    for(int i =1; i <argc; i++){
+        if(strcmp(argv[i], "--headless") ==0){
+            headless = 1;
+        }else if(strcmp(argv[i], "--max-ticks") ==0 && i +1 <argc){
+            max_ticks = atol(argv[++i]);
+        }else if(strcmp(argv[i], "--seed") ==0 && i +1 <argc){
+            master_seed = strtoull(argv[++i], NULL, 10);
+        }else if(strcmp(argv[i], "--save-mode") ==0 && i +1 <argc && strcmp(argv[i +1], "fork") ==0){
+            save_mode = SAVE_FORK;
+            i++;
+        }else if(strcmp(argv[i], "--save-mode") ==0 && i +1 <argc && strcmp(argv[i +1], "snapshot") ==0){
+            save_mode = SAVE_SNAPSHOT;
+            i++;
+        }else if(strcmp(argv[i], "--save-file") ==0 && i +1 <argc){
+            save_path = argv[++i];
+        }else if(strcmp(argv[i], "--resume") ==0 && i +1 <argc){
+            resume_path = argv[++i];
+        }else if(strcmp(argv[i], "--record") ==0 && i +1 <argc){
+            record_path = argv[++i];
+        }else if(strcmp(argv[i], "--replay") ==0 && i +1 <argc){
+            replay_path = argv[++i];
+        }else if(strcmp(argv[i], "--trace") ==0 && i +1 <argc){
+            trace_path = argv[++i];
+        }else if(argv[i][0] != '-' && level_dir == NULL){
+            level_dir = argv[i];
+        }else{
+            usage(argv[0]);
+            return 1;
+        }
     }
-    int count; //number of levels
-    char **lvl_files = get_lvl_files(argv[1], &count);
-    if(lvl_files ==  NULL){
+    //a recording starts from the first level with a player at the keyboard, a replay brings its own levels and keys
+    if((record_path != NULL && (resume_path != NULL || headless || replay_path != NULL)) ||
+       (replay_path != NULL && (resume_path != NULL || save_path != NULL || level_dir != NULL))){
+        usage(argv[0]);
         return 1;
     }
+    int count; //number of levels
+    char **lvl_files;
+    session_t session;
+    if(replay_path != NULL){
+        if(replay_open(&replay, replay_path, &session) ==-1){
+            return 1;
+        }
+        level_dir = session.level_dir;
+        lvl_files = session.lvl_files;
+        count = session.count;
+        master_seed = session.seed;
+    }else if(resume_path != NULL){
+        //the save file knows the levels and the seed, the directory is not scanned again
+        if(read_save_session(resume_path, &session) ==-1){
+            return 1;
+        }
+        level_dir = session.level_dir;
+        lvl_files = session.lvl_files;
+        count = session.count;
+        master_seed = session.seed;
+        first_level = session.level;
+    }else{
+        if (level_dir == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        lvl_files = get_lvl_files(level_dir, &count);
+        if(lvl_files ==  NULL){
+            return 1;
+        }
+    }
 
-    // Random seed for any random movements
-    srand((unsigned int)time(NULL));
+    if(record_path != NULL){
+        session_t recorded = {master_seed, "", lvl_files, count, 0};
+        snprintf(recorded.level_dir, sizeof(recorded.level_dir), "%s", level_dir);
+        if(replay_record_start(&replay, record_path, &recorded) ==-1){
+            free_lvl_files(lvl_files, count);
+            return 1;
+        }
+    }
+    //a forked child would log its keys into the same file as the parent, quicksaves are snapshots
+    lockstep = record_path != NULL || replay_path != NULL;
+    if(lockstep){
+        save_mode = SAVE_SNAPSHOT;
+    }
 
+    //before any thread is created, so every thread finds it enabled
+    if(trace_path != NULL && tracer_open(trace_path) ==-1){
+        free_lvl_files(lvl_files, count);
+        return 1;
+    }
     open_debug_file("debug.log");
+    debug("SEED %llu\n", (unsigned long long)master_seed);
+
+    if(headless && replay_path == NULL){
+        int ret = run_headless(level_dir, lvl_files, count, max_ticks);
+        stats_exit();
+        tracer_close();
+        close_debug_file();
+        free_lvl_files(lvl_files, count);
+        return ret;
+    }
 
-    terminal_init();
+    //an unthrottled replay runs the same loop as a game, without the terminal
+    if(!headless){
+        terminal_init();
+    }
     
     int accumulated_points = 0;
     bool end_game = false;
-    board_t game_board;
-    pthread_mutex_init(&game_board.lock, NULL);
-    int current_level =0;
-
-    while (!end_game) {
-        char path[128];
-        snprintf(path, sizeof(path), "%s/%s", argv[1], lvl_files[current_level]);
+    board_t boards[2];
+    for(int b =0; b <2; b++){
+        pthread_mutex_init(&boards[b].lock, NULL);
+        arena_init(&boards[b].arena, ARENA_BLOCK_SIZE);
+        boards[b].on_save = 0;
+    }
+    board_t *game_board = &boards[0];
+    board_t *next_board = &boards[1];
+    level_loader_t loader;
+    level_loader_init(&loader);
+    snapshot_store_t saves;
+    snapshot_store_init(&saves);
+    int rewind = 0; //1 when the quicksave to go back to is from an earlier level
+    int current_level =first_level;
+    ghost_pool_t pool;
+    if(ghost_pool_init(&pool, 0) ==-1){
+        return -1; //error creating threads
+    }
+    if(input_init(&input) ==-1){
+        leave_terminal();
+        return 1;
+    }
+    renderer_init(&renderer);
+    if(!headless){
+        renderer_start(&renderer);
+        input_start(&input);
+    }
+    tick_pacer_init(&pacman_pacer);
 
-        //loads the level name
-        snprintf(game_board.level_name, sizeof(game_board.level_name), "%s", lvl_files[current_level]);
+    if(load_first_level(game_board, level_dir, lvl_files) ==-1){
+        leave_terminal();
+        return 1;
+    }
+    accumulated_points = game_board->pacmans[0].points;
 
-        int fd = open(path, O_RDONLY);
-        if (fd < 0) {
-            perror("open");
-            return 1;
-        }
+    while (!end_game) {
         current_level++;
-        
-        load_level(&game_board, accumulated_points, fd, argv[1]);
-        close(fd);
 
-        game_board.threads_live =1;
-        
-        pthread_t tid[game_board.n_ghosts];
-        if(start_threads(tid, &game_board) ==-1){
-            return -1; //error creating threads
+        //the next level is parsed while this one is played, moving to it is a pointer swap
+        int prefetching = current_level < count;
+        if(prefetching){
+            level_loader_start(&loader, next_board, level_dir, lvl_files[current_level], rng_mix(master_seed, current_level));
         }
+
+        session_event(REPLAY_LEVEL, current_level -1);
+        ghost_pool_attach(&pool, game_board);
+        start_ticks(&pool);
         
 
-        draw_board(&game_board, DRAW_MENU);
-        refresh_screen();
+        if(!headless){
+            renderer_publish(&renderer, game_board, DRAW_MENU);
+        }
 
         while(true) {
-            int result = play_board(&game_board); 
+            stats_start(start);
+            int result = play_board(game_board); 
+            stats_stop(STAT_PLAY_BOARD, start);
             if(result == NEXT_LEVEL) {
 
-                game_board.threads_live =0;
-                for(int i =0; i <game_board.n_ghosts; i++){
-                    pthread_join(tid[i], NULL);
-                }
+                ghost_pool_stop(&pool);
 
                 if(current_level>=count){
                     end_game = true;
-                    screen_refresh(&game_board, DRAW_WIN);
-                    sleep_ms(game_board.tempo);
-                    if(game_board.on_save ==1){
+                    screen_refresh(game_board, DRAW_WIN);
+                    if(!headless){
+                        sleep_ms(game_board->tempo);
+                    }
+                    if(game_board->on_save ==1){
+                        renderer_stop(&renderer);
                         exit(WON_GAME);
                     }
                     
@@ -213,53 +571,97 @@ int main(int argc, char** argv) {
             }
             if(result == QUIT_GAME) {
                 //wait for threads to finish
-                game_board.threads_live =0;
-                for(int i =0; i <game_board.n_ghosts; i++){
-                   pthread_join(tid[i], NULL);
+                ghost_pool_stop(&pool);
+
+                snapshot_t *quicksave = snapshot_find(&saves, QUICKSAVE_SLOT);
+                if(!game_board->pacmans[0].alive && quicksave != NULL){
+                    if(quicksave->level != current_level -1){
+                        rewind = 1;
+                        break;
+                    }
+                    //same level, only the state is copied back
+                    if(snapshot_restore(quicksave, game_board) ==-1){
+                        end_game = true;
+                        break;
+                    }
+                    snapshot_drop(&saves, QUICKSAVE_SLOT);
+                    debug("SNAPSHOT RESTORE %s\n", game_board->level_name);
+                    start_ticks(&pool);
+                    screen_refresh(game_board, DRAW_MENU);
+                    continue;
                 }
                 
-                if(game_board.on_save ==1){
-                    if(game_board.pacmans[0].alive ==1){
+                if(game_board->on_save ==1){
+                    renderer_stop(&renderer);
+                    if(game_board->pacmans[0].alive ==1){
                         exit(QUIT_GAME);
                     }
                     else{
                         exit(0);
                     }
                 }
-                if(game_board.pacmans[0].alive ==1){
+                if(game_board->pacmans[0].alive ==1){
                     end_game = true;
                     break;
                 }
 
-                screen_refresh(&game_board, DRAW_GAME_OVER); 
-                sleep_ms(game_board.tempo);
+                screen_refresh(game_board, DRAW_GAME_OVER); 
+                if(!headless){
+                    sleep_ms(game_board->tempo);
+                }
                 
                 end_game = true;
                 break;
             }
 
-            if(result == CREATE_BACKUP){
-                
-                if(game_board.on_save ==0 ){
-                    game_board.on_save =1;
+            if(result == CREATE_BACKUP && save_mode == SAVE_SNAPSHOT){
+                ghost_pool_stop(&pool);
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                if(snapshot_save(&saves, QUICKSAVE_SLOT, game_board, current_level -1) ==-1){
+                    perror("snapshot");
+                }else{
+                    clock_gettime(CLOCK_MONOTONIC, &end);
+                    debug("SNAPSHOT SAVE %s %ld us\n", game_board->level_name,
+                          (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000);
+                }
+                write_save_file(game_board, level_dir, lvl_files, count, current_level -1);
+                start_ticks(&pool);
 
-                    game_board.threads_live =0;
-                    for(int i =0; i <game_board.n_ghosts; i++){
-                        pthread_join(tid[i], NULL);
-                    }
+            }else if(result == CREATE_BACKUP){
+                
+                if(game_board->on_save ==0 ){
+                    game_board->on_save =1;
+
+                    ghost_pool_stop(&pool);
+                    write_save_file(game_board, level_dir, lvl_files, count, current_level -1);
+                    //the loader, render, input and log writer threads would not exist in the child
+                    level_loader_wait(&loader);
+                    renderer_stop(&renderer);
+                    input_stop(&input);
+                    log_before_fork();
                     
+                    trace_begin("fork");
                     pid_t pid = fork();
                     if (pid < 0) {
                         perror("fork failed");
                         exit(1);
                     }
                     if(pid != 0){
+                        trace_end("fork");
                         int status;
+                        trace_begin("waitpid");
                         pid_t waiting = waitpid(pid, &status, 0);
+                        trace_end("waitpid");
+                        log_after_fork(0);
                         if (waiting == -1) {
                             perror("waitpid");
                             exit(1);
                         }
+                        //the child read the keys typed while it played
+                        input_drop(&input);
+                        renderer_start(&renderer);
+                        input_start(&input);
                         if(WIFEXITED(status)){
                             if(WEXITSTATUS(status)==WON_GAME){
                                 end_game = true;
@@ -268,42 +670,107 @@ int main(int argc, char** argv) {
                                 end_game = true;
                                 break;
                             }
-                            else{
-                                game_board.threads_live =1;
-                                pthread_t tid[game_board.n_ghosts];
-                                if(start_threads(tid, &game_board) ==-1){
-                                    return -1; //error creating threads
-                                }
-                            }
                         }
-                        game_board.on_save =0;
+                        start_ticks(&pool);
+                        game_board->on_save =0;
+                        //the child drew over the terminal
+                        game_board->full_redraw =1;
                         
                     }
                     if(pid ==0){
-                        game_board.threads_live =1;
-                        pthread_t tid[game_board.n_ghosts];
-                        if(start_threads(tid, &game_board) ==-1){
+                        tracer_after_fork("quicksave child");
+                        log_after_fork(1);
+                        if(ghost_pool_after_fork(&pool) ==-1){
                             return -1; //error creating threads
                         }
+                        renderer_start(&renderer);
+                        input_start(&input);
+                        start_ticks(&pool);
                     }
 
                 }
                 
             }
-            
-            screen_refresh(&game_board, DRAW_MENU); 
 
-            accumulated_points = game_board.pacmans[0].points;      
+            if(lockstep){
+                ghost_pool_tick(&pool);
+            }
+            screen_refresh(game_board, DRAW_MENU); 
+
+            accumulated_points = game_board->pacmans[0].points;      
+        }
+        ghost_pool_detach(&pool);
+        log_ticks(game_board->level_name, &pool);
+        stats_level_end(game_board->level_name, game_board->tempo);
+        print_board(game_board);
+        int on_save = game_board->on_save;
+        unload_level(game_board);
+
+        int prefetched = prefetching ? level_loader_wait(&loader) : -1;
+        if(rewind){
+            //the quicksave is from an earlier level, which is loaded again under the saved state
+            if(prefetched ==0){
+                unload_level(next_board);
+            }
+            snapshot_t *quicksave = snapshot_find(&saves, QUICKSAVE_SLOT);
+            if(load_level_file(game_board, level_dir, lvl_files[quicksave->level], rng_mix(master_seed, quicksave->level), 0) ==-1 ||
+               snapshot_restore(quicksave, game_board) ==-1){
+                leave_terminal();
+                return 1;
+            }
+            debug("SNAPSHOT RESTORE %s\n", game_board->level_name);
+            current_level = quicksave->level;
+            snapshot_drop(&saves, QUICKSAVE_SLOT);
+            rewind = 0;
+            continue;
+        }
+        if(end_game){
+            if(prefetched ==0){
+                unload_level(next_board);
+            }
+            break;
         }
-        print_board(&game_board);
-        unload_level(&game_board);
+        if(prefetched ==-1){
+            leave_terminal();
+            return 1;
+        }
+        swap_boards(&game_board, &next_board, accumulated_points);
+        game_board->on_save = on_save;
     }    
 
-    terminal_cleanup();
+    session_event(REPLAY_END, accumulated_points);
+    replay_record_stop(&replay);
+    ghost_pool_destroy(&pool);
+    snapshot_store_free(&saves);
+    for(int b =0; b <2; b++){
+        arena_release(&boards[b].arena);
+        pthread_mutex_destroy(&boards[b].lock);
+    }
+
+    leave_terminal();
+    input_destroy(&input);
+    renderer_destroy(&renderer);
 
+    stats_exit();
+    tracer_close();
     close_debug_file();
 
     free_lvl_files(lvl_files, count);
+
+    int ret = 0;
+    if(replay_path != NULL){
+        if(replay_stopped){
+            printf("replay stopped at tick %ld\n", session_ticks);
+            ret = 1;
+        }else if(replay.diverged != -1){
+            printf("replay diverged at tick %ld\n", replay.diverged);
+            ret = 1;
+        }else{
+            printf("replay ok ticks=%ld points=%d seed=%llu\n", session_ticks, accumulated_points,
+                   (unsigned long long)master_seed);
+        }
+        replay_close(&replay);
+    }
    
-    return 0;
+    return ret;
 }
@@ -0,0 +1,254 @@
+#include "ghost_pool.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+static void *worker_thread(void *arg);
+static void *clock_thread(void *arg);
+
+typedef struct{
+    ghost_pool_t *pool;
+    int index;
+} worker_args;
+
+static int create_threads(ghost_pool_t *pool){
+    //workers start out having seen job 0, the first plan phase bumps it to 1
+    pool->job = 0;
+    for(int w =0; w <pool->n_workers; w++){
+        worker_args *args = malloc(sizeof(worker_args));
+        args->pool = pool;
+        args->index = w;
+        if(pthread_create(&pool->workers[w], NULL, worker_thread, args) != 0){
+            fprintf(stderr, "error creating thread.\n");
+            return -1;
+        }
+    }
+    if(pthread_create(&pool->clock, NULL, clock_thread, pool) != 0){
+        fprintf(stderr, "error creating thread.\n");
+        return -1;
+    }
+    return 0;
+}
+
+//the clock waits with absolute CLOCK_MONOTONIC deadlines, immune to wall clock changes
+static void init_sync(ghost_pool_t *pool){
+    pthread_mutex_init(&pool->mutex, NULL);
+    tick_cond_init(&pool->cond);
+}
+
+static long elapsed_us(struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+int ghost_pool_init(ghost_pool_t *pool, int n_workers){
+    if(n_workers <= 0){
+        n_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if(n_workers <= 0) n_workers = 1;
+    }
+    pool->n_workers = n_workers;
+    pool->workers = malloc(n_workers * sizeof(pthread_t));
+    init_sync(pool);
+    pool->board = NULL;
+    pool->intents = NULL;
+    pool->intents_size = 0;
+    pool->active = 0;
+    pool->pending = 0;
+    pool->clock_parked = 1;
+    pool->exiting = 0;
+    pool->stop_latency_us = 0;
+    tick_pacer_init(&pool->pacer);
+    return create_threads(pool);
+}
+
+void ghost_pool_destroy(ghost_pool_t *pool){
+    pthread_mutex_lock(&pool->mutex);
+    pool->exiting = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_join(pool->clock, NULL);
+    for(int w =0; w <pool->n_workers; w++){
+        pthread_join(pool->workers[w], NULL);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    free(pool->workers);
+    free(pool->intents);
+}
+
+void ghost_pool_attach(ghost_pool_t *pool, board_t *board){
+    pthread_mutex_lock(&pool->mutex);
+    if(board->n_ghosts > pool->intents_size){
+        pool->intents = realloc(pool->intents, board->n_ghosts * sizeof(ghost_intent_t));
+        pool->intents_size = board->n_ghosts;
+    }
+    atomic_store(&board->threads_live, 0);
+    pool->board = board;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void ghost_pool_detach(ghost_pool_t *pool){
+    pthread_mutex_lock(&pool->mutex);
+    pool->board = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void ghost_pool_start(ghost_pool_t *pool){
+    pthread_mutex_lock(&pool->mutex);
+    //the clock is parked, its first tick is tick 0 of the new timeline
+    tick_timeline_start(&pool->board->timeline, pool->board->tempo);
+    tick_pacer_restart(&pool->pacer);
+    atomic_store(&pool->board->threads_live, 1);
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void ghost_pool_stop(ghost_pool_t *pool){
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_mutex_lock(&pool->mutex);
+    if(pool->board != NULL){
+        atomic_store(&pool->board->threads_live, 0);
+    }
+    //wakes the clock if it is waiting for its next tick
+    pthread_cond_broadcast(&pool->cond);
+    while(!pool->clock_parked){
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    pool->stop_latency_us = elapsed_us(&start);
+    debug("POOL STOP %ld us\n", pool->stop_latency_us);
+}
+
+//phase 1, spread over the workers when there are enough ghosts
+static void plan_tick(ghost_pool_t *pool, board_t *board){
+    int active = board->n_ghosts / POOL_MIN_GHOSTS_PER_WORKER;
+    if(active > pool->n_workers) active = pool->n_workers;
+    if(active <= 1){
+        plan_ghosts(board, pool->intents, 0, 1);
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->active = active;
+    pool->pending = active;
+    pool->job++;
+    pthread_cond_broadcast(&pool->cond);
+    while(pool->pending > 0){
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int ghost_pool_tick(ghost_pool_t *pool){
+    board_t *board = pool->board;
+    trace_begin("ghost plan");
+    stats_start(plan_start);
+    plan_tick(pool, board);
+    stats_stop(STAT_GHOST_PLAN, plan_start);
+    trace_end("ghost plan");
+
+    //phase 2, a single thread applies every move in ghost index order
+    board_lock(board);
+    trace_begin("ghost apply");
+    stats_start(apply_start);
+    int result = resolve_ghosts(board, pool->intents);
+    stats_stop(STAT_GHOST_APPLY, apply_start);
+    trace_end("ghost apply");
+    board_unlock(board);
+    return result;
+}
+
+static void *worker_thread(void *arg){
+    worker_args *args = (worker_args *)arg;
+    ghost_pool_t *pool = args->pool;
+    int index = args->index;
+    free(args);
+    trace_thread("ghost worker");
+
+    pthread_mutex_lock(&pool->mutex);
+    unsigned long seen = 0;
+    while(1){
+        while(seen == pool->job && !pool->exiting){
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        if(pool->exiting){
+            break;
+        }
+        seen = pool->job;
+        if(index >= pool->active){
+            continue;
+        }
+        board_t *board = pool->board;
+        int stride = pool->active;
+        pthread_mutex_unlock(&pool->mutex);
+
+        //no lock held, every ghost is planned by exactly one worker
+        trace_begin("ghost plan");
+        plan_ghosts(board, pool->intents, index, stride);
+        trace_end("ghost plan");
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->pending--;
+        if(pool->pending == 0){
+            pthread_cond_broadcast(&pool->cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+static void *clock_thread(void *arg){
+    ghost_pool_t *pool = (ghost_pool_t *)arg;
+    trace_thread("ghost clock");
+
+    pthread_mutex_lock(&pool->mutex);
+    while(1){
+        //a level without ghosts has nothing to tick, the clock stays parked instead of spinning at TEMPO 0
+        while(!pool->exiting && (pool->board == NULL || !atomic_load(&pool->board->threads_live) || pool->board->n_ghosts == 0)){
+            if(!pool->clock_parked){
+                pool->clock_parked =1;
+                pthread_cond_broadcast(&pool->cond);
+            }
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        if(pool->exiting){
+            break;
+        }
+        pool->clock_parked =0;
+        board_t *board = pool->board;
+        pthread_mutex_unlock(&pool->mutex);
+
+        ghost_pool_tick(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (!board->pacmans[0].alive) {
+            atomic_store(&board->threads_live, 0);
+            continue;
+        }
+        //waits for the next tick, a stop request or exit broadcasts the condition and ends the wait early
+        struct timespec deadline;
+        tick_pacer_next(&pool->pacer, &board->timeline, &deadline);
+        trace_begin("sleep");
+        while(atomic_load(&board->threads_live) && !pool->exiting){
+            if(tick_cond_timedwait(&pool->cond, &pool->mutex, &deadline) == ETIMEDOUT){
+                break;
+            }
+        }
+        trace_end("sleep");
+    }
+    pool->clock_parked =1;
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+int ghost_pool_after_fork(ghost_pool_t *pool){
+    //the parent's threads are gone, only their memory was copied
+    init_sync(pool);
+    pool->pending = 0;
+    pool->clock_parked =1;
+    return create_threads(pool);
+}
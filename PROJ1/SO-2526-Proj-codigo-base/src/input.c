@@ -0,0 +1,192 @@
+#include "input.h"
+#include "tracer.h"
+#include "display.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+//escape sequences (arrows, function keys) are skipped, their last byte would look like a key
+static char filter_byte(input_t *input, unsigned char byte){
+    switch(input->escape){
+    case 1: //right after ESC, '[' or 'O' starts a sequence
+        if(byte == '[' || byte == 'O'){
+            input->escape = 2;
+            return '\0';
+        }
+        input->escape = 0;
+        break;
+    case 2: //parameters up to the final byte
+        if(byte >= 0x40 && byte <= 0x7e){
+            input->escape = 0;
+        }
+        return '\0';
+    }
+    if(byte == 0x1b){
+        input->escape = 1;
+        return '\0';
+    }
+    return key_command(byte);
+}
+
+//producer side of the ring, only called by whoever reads stdin
+static int push_key(input_t *input, char key){
+    unsigned tail = atomic_load_explicit(&input->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&input->head, memory_order_acquire);
+    if(tail - head == INPUT_QUEUE_SIZE){
+        input->dropped++;
+        return -1;
+    }
+    input->keys[tail % INPUT_QUEUE_SIZE] = key;
+    //the key is written before the game thread can see the new tail
+    atomic_store_explicit(&input->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+//reads what stdin has, returns -1 once there is nothing more to read from it
+static int read_keys(input_t *input){
+    unsigned char bytes[64];
+    ssize_t n = read(STDIN_FILENO, bytes, sizeof(bytes));
+    if(n < 0){
+        return errno == EINTR || errno == EAGAIN ? 0 : -1;
+    }
+    if(n == 0){
+        return -1;
+    }
+    int queued = 0;
+    for(ssize_t i = 0; i < n; i++){
+        char key = filter_byte(input, bytes[i]);
+        if(key != '\0' && push_key(input, key) == 0){
+            queued = 1;
+        }
+    }
+    if(queued){
+        //a full pipe already means a wake up is pending
+        if(write(input->notify[1], "k", 1) == -1 && errno != EAGAIN){
+            perror("input notify");
+        }
+    }
+    return 0;
+}
+
+static void *input_thread(void *arg){
+    input_t *input = arg;
+    trace_thread("input");
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {input->wake[0], POLLIN, 0}};
+    while(1){
+        //nothing runs here until a key is typed or input_stop writes to the wake pipe
+        if(poll(fds, 2, -1) == -1){
+            if(errno == EINTR){
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        if(fds[1].revents != 0){
+            break;
+        }
+        trace_begin("read keys");
+        int failed = fds[0].revents != 0 && read_keys(input) == -1;
+        trace_end("read keys");
+        if(failed){
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int set_nonblocking(int fd){
+    int flags = fcntl(fd, F_GETFL);
+    return flags == -1 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int input_init(input_t *input){
+    input->running = 0;
+    input->escape = 0;
+    input->dropped = 0;
+    atomic_init(&input->head, 0);
+    atomic_init(&input->tail, 0);
+    if(pipe(input->wake) == -1){
+        perror("pipe");
+        return -1;
+    }
+    if(pipe(input->notify) == -1 || set_nonblocking(input->notify[0]) == -1 || set_nonblocking(input->notify[1]) == -1){
+        perror("pipe");
+        close(input->wake[0]);
+        close(input->wake[1]);
+        return -1;
+    }
+    return 0;
+}
+
+void input_start(input_t *input){
+    if(input->running){
+        return;
+    }
+    if(pthread_create(&input->thread, NULL, input_thread, input) != 0){
+        //no thread to spare, input_take reads stdin instead
+        return;
+    }
+    input->running = 1;
+}
+
+void input_stop(input_t *input){
+    if(!input->running){
+        return;
+    }
+    char byte = 'x';
+    if(write(input->wake[1], &byte, 1) == -1){
+        perror("input wake");
+    }
+    pthread_join(input->thread, NULL);
+    //the thread may have ended on its own, only a byte that was written is read back
+    struct pollfd fd = {input->wake[0], POLLIN, 0};
+    if(poll(&fd, 1, 0) == 1 && read(input->wake[0], &byte, 1) == -1){
+        perror("input wake");
+    }
+    input->running = 0;
+}
+
+void input_destroy(input_t *input){
+    close(input->wake[0]);
+    close(input->wake[1]);
+    close(input->notify[0]);
+    close(input->notify[1]);
+}
+
+char input_take(input_t *input){
+    if(!input->running){
+        struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+        if(poll(&fd, 1, 0) == 1){
+            read_keys(input);
+        }
+    }
+    unsigned head = atomic_load_explicit(&input->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&input->tail, memory_order_acquire);
+    if(head == tail){
+        return '\0';
+    }
+    char key = input->keys[head % INPUT_QUEUE_SIZE];
+    //the slot may be reused once the input thread sees the new head
+    atomic_store_explicit(&input->head, head + 1, memory_order_release);
+    return key;
+}
+
+void input_wait(input_t *input, int timeout_ms){
+    unsigned head = atomic_load_explicit(&input->head, memory_order_relaxed);
+    if(head != atomic_load_explicit(&input->tail, memory_order_acquire)){
+        return;
+    }
+    //a key queued after the check above still leaves a byte in the pipe, so the poll returns
+    struct pollfd fd = {input->running ? input->notify[0] : STDIN_FILENO, POLLIN, 0};
+    if(poll(&fd, 1, timeout_ms) == 1 && input->running){
+        char drain[64];
+        while(read(input->notify[0], drain, sizeof(drain)) > 0){
+        }
+    }
+}
+
+void input_drop(input_t *input){
+    atomic_store_explicit(&input->head, atomic_load_explicit(&input->tail, memory_order_acquire), memory_order_release);
+}
@@ -0,0 +1,80 @@
+#include "level_loader.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+static long elapsed_us(struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+int load_level_file(board_t *board, char *dirpath, char *file, uint64_t seed, int points){
+    char path[2 * MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/%s", dirpath, file);
+    snprintf(board->level_name, sizeof(board->level_name), "%s", file);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    board->seed = seed;
+    trace_begin("load level");
+    int loaded = load_level(board, points, fd, dirpath);
+    trace_end("load level");
+    close(fd);
+    if(loaded ==-1){
+        fprintf(stderr, "could not load level %s\n", path);
+        //drops whatever was loaded before the error
+        arena_reset(&board->arena);
+        return -1;
+    }
+    return 0;
+}
+
+static void *loader_thread(void *arg){
+    level_loader_t *loader = arg;
+    trace_thread("level loader");
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    loader->result = load_level_file(loader->board, loader->dirpath, loader->file, loader->seed, 0);
+    loader->load_us = elapsed_us(&start);
+    return NULL;
+}
+
+void level_loader_init(level_loader_t *loader){
+    loader->busy = 0;
+    loader->board = NULL;
+    loader->result = -1;
+    loader->load_us = 0;
+}
+
+void level_loader_start(level_loader_t *loader, board_t *board, char *dirpath, char *file, uint64_t seed){
+    level_loader_wait(loader);
+    loader->board = board;
+    loader->dirpath = dirpath;
+    loader->file = file;
+    loader->seed = seed;
+    loader->result = -1;
+    if(pthread_create(&loader->thread, NULL, loader_thread, loader) != 0){
+        //no thread to spare, the level is loaded right away instead
+        loader_thread(loader);
+        return;
+    }
+    loader->busy = 1;
+}
+
+int level_loader_wait(level_loader_t *loader){
+    if(loader->busy){
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        trace_begin("wait prefetch");
+        pthread_join(loader->thread, NULL);
+        trace_end("wait prefetch");
+        loader->busy = 0;
+        debug("PREFETCH %s load=%ld us stall=%ld us\n", loader->file, loader->load_us, elapsed_us(&start));
+    }
+    return loader->result;
+}
@@ -0,0 +1,363 @@
+#include "log.h"
+#include "tick.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+// what comes before the bytes of every record in a ring
+typedef struct {
+    uint64_t seq;               // global order of the records, the writer merges the rings by it
+    uint32_t size;              // bytes after the header
+    log_formatter_t formatter;  // NULL for text
+} record_t;
+
+// ring of one thread, that thread is its only producer and the writer thread its only consumer
+typedef struct log_ring {
+    char data[LOG_RING_SIZE];
+    atomic_size_t head;         // next byte to read, only moved by the writer
+    atomic_size_t tail;         // next byte to write, only moved by the owner thread
+    atomic_int orphaned;        // the owner thread is gone, the writer frees the ring once it is empty
+    atomic_long dropped;        // records that did not fit
+    struct log_ring *next;
+} log_ring_t;
+
+static struct {
+    FILE *file;
+    atomic_int open;
+    _Atomic(log_ring_t *) rings;    // threads push their ring with a CAS, only the writer unlinks
+    atomic_ulong seq;
+    pthread_t writer;
+    int writer_running;
+    pthread_mutex_t mutex;          // held by whoever writes to the file, the writer only lets go of it to wait
+    pthread_cond_t cond;            // a stop was requested or the writer finished, waited on with tick_cond_timedwait
+    int exiting;
+    char *buffer;                   // writer only, holds the record being written
+    size_t buffer_size;
+    long dropped;                   // records dropped by rings already freed
+} logger;
+
+static _Thread_local log_ring_t *thread_ring;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static void orphan_ring(void *ring){
+    atomic_store(&((log_ring_t *)ring)->orphaned, 1);
+}
+
+static void make_ring_key(void){
+    pthread_key_create(&ring_key, orphan_ring);
+}
+
+//ring of the calling thread, created and linked the first time it logs
+static log_ring_t *get_ring(void){
+    if(thread_ring == NULL){
+        pthread_once(&ring_key_once, make_ring_key);
+        log_ring_t *ring = malloc(sizeof(log_ring_t));
+        if(ring == NULL){
+            return NULL;
+        }
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        atomic_init(&ring->orphaned, 0);
+        atomic_init(&ring->dropped, 0);
+        ring->next = atomic_load(&logger.rings);
+        while(!atomic_compare_exchange_weak(&logger.rings, &ring->next, ring)){
+        }
+        thread_ring = ring;
+        pthread_setspecific(ring_key, ring);
+    }
+    return thread_ring;
+}
+
+static void ring_copy_in(log_ring_t *ring, size_t pos, const void *src, size_t size){
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = size < LOG_RING_SIZE - offset ? size : LOG_RING_SIZE - offset;
+    memcpy(ring->data + offset, src, first);
+    memcpy(ring->data, (const char *)src + first, size - first);
+}
+
+static void ring_copy_out(const log_ring_t *ring, size_t pos, void *dst, size_t size){
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = size < LOG_RING_SIZE - offset ? size : LOG_RING_SIZE - offset;
+    memcpy(dst, ring->data + offset, first);
+    memcpy((char *)dst + first, ring->data, size - first);
+}
+
+static void drain(void);
+
+//writer only, or with logger.mutex held
+static int reserve_buffer(size_t size){
+    if(size > logger.buffer_size){
+        char *buffer = realloc(logger.buffer, size);
+        if(buffer == NULL){
+            return -1;
+        }
+        logger.buffer = buffer;
+        logger.buffer_size = size;
+    }
+    return 0;
+}
+
+//a record bigger than a ring goes straight to the file after everything logged before it, the caller waits for the disk
+static void write_through(log_formatter_t formatter, const log_part_t *parts, int n_parts, size_t size){
+    pthread_mutex_lock(&logger.mutex);
+    drain();
+    if(reserve_buffer(size) == 0){
+        size_t pos = 0;
+        for(int i = 0; i < n_parts; i++){
+            memcpy(logger.buffer + pos, parts[i].data, parts[i].size);
+            pos += parts[i].size;
+        }
+        if(formatter != NULL){
+            formatter(logger.file, logger.buffer, size);
+        }else{
+            fwrite(logger.buffer, 1, size, logger.file);
+        }
+        fflush(logger.file);
+    }else{
+        logger.dropped++;
+    }
+    pthread_mutex_unlock(&logger.mutex);
+}
+
+static void push_record(log_formatter_t formatter, const log_part_t *parts, int n_parts){
+    log_ring_t *ring = get_ring();
+    if(ring == NULL){
+        return;
+    }
+    size_t size = 0;
+    for(int i = 0; i < n_parts; i++){
+        size += parts[i].size;
+    }
+    if(sizeof(record_t) + size > LOG_RING_SIZE){
+        write_through(formatter, parts, n_parts, size);
+        return;
+    }
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if(sizeof(record_t) + size > LOG_RING_SIZE - (tail - head)){
+        //the writer is behind, losing a line is better than stalling the game
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    record_t record = {atomic_fetch_add(&logger.seq, 1), (uint32_t)size, formatter};
+    ring_copy_in(ring, tail, &record, sizeof(record));
+    size_t pos = tail + sizeof(record);
+    for(int i = 0; i < n_parts; i++){
+        ring_copy_in(ring, pos, parts[i].data, parts[i].size);
+        pos += parts[i].size;
+    }
+    //the bytes are in place before the writer can see the new tail
+    atomic_store_explicit(&ring->tail, pos, memory_order_release);
+}
+
+void log_text(int level, const char *format, ...){
+    (void)level; //filtered at compile time by log_at
+    if(!atomic_load_explicit(&logger.open, memory_order_relaxed)){
+        return;
+    }
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if(len < 0){
+        return;
+    }
+    log_part_t part = {line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1};
+    push_record(NULL, &part, 1);
+}
+
+void log_binary(int level, log_formatter_t formatter, const log_part_t *parts, int n_parts){
+    (void)level;
+    if(!atomic_load_explicit(&logger.open, memory_order_relaxed)){
+        return;
+    }
+    push_record(formatter, parts, n_parts);
+}
+
+//frees the rings whose thread is gone once they are empty, the first ring is left for the pushes to link to
+static void free_orphans(void){
+    log_ring_t *prev = atomic_load(&logger.rings);
+    if(prev == NULL){
+        return;
+    }
+    log_ring_t *ring = prev->next;
+    while(ring != NULL){
+        log_ring_t *next = ring->next;
+        if(atomic_load(&ring->orphaned) && atomic_load(&ring->head) == atomic_load(&ring->tail)){
+            logger.dropped += atomic_load(&ring->dropped);
+            prev->next = next;
+            free(ring);
+        }else{
+            prev = ring;
+        }
+        ring = next;
+    }
+}
+
+//writes every record in the rings to the file, oldest first across all threads
+static void drain(void){
+    while(1){
+        log_ring_t *oldest = NULL;
+        record_t record;
+        for(log_ring_t *ring = atomic_load(&logger.rings); ring != NULL; ring = ring->next){
+            size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            if(head == atomic_load_explicit(&ring->tail, memory_order_acquire)){
+                continue;
+            }
+            record_t candidate;
+            ring_copy_out(ring, head, &candidate, sizeof(candidate));
+            if(oldest == NULL || candidate.seq < record.seq){
+                oldest = ring;
+                record = candidate;
+            }
+        }
+        if(oldest == NULL){
+            break;
+        }
+
+        if(reserve_buffer(record.size) != 0){
+            break;
+        }
+        size_t head = atomic_load_explicit(&oldest->head, memory_order_relaxed) + sizeof(record);
+        ring_copy_out(oldest, head, logger.buffer, record.size);
+        //the owner may reuse the space once the new head is seen
+        atomic_store_explicit(&oldest->head, head + record.size, memory_order_release);
+        if(record.formatter != NULL){
+            record.formatter(logger.file, logger.buffer, record.size);
+        }else{
+            fwrite(logger.buffer, 1, record.size, logger.file);
+        }
+    }
+    fflush(logger.file);
+    free_orphans();
+}
+
+static void *writer_thread(void *arg){
+    (void)arg;
+    pthread_mutex_lock(&logger.mutex);
+    while(1){
+        int exiting = logger.exiting;
+
+        //the disk is only touched here, every LOG_FLUSH_MS and once more when stopping, and by write_through
+        drain();
+
+        if(exiting){
+            break;
+        }
+        if(!logger.exiting){
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_nsec += LOG_FLUSH_MS * 1000000L;
+            if(deadline.tv_nsec >= 1000000000L){
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            tick_cond_timedwait(&logger.cond, &logger.mutex, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&logger.mutex);
+    return NULL;
+}
+
+static void init_sync(void){
+    pthread_mutex_init(&logger.mutex, NULL);
+    tick_cond_init(&logger.cond);
+}
+
+static void start_writer(void){
+    logger.exiting = 0;
+    if(pthread_create(&logger.writer, NULL, writer_thread, NULL) != 0){
+        //without a writer the rings would only fill up
+        fprintf(stderr, "error creating thread.\n");
+        atomic_store(&logger.open, 0);
+        return;
+    }
+    logger.writer_running = 1;
+}
+
+//the writer drains the rings once more before ending
+static void stop_writer(void){
+    if(!logger.writer_running){
+        return;
+    }
+    pthread_mutex_lock(&logger.mutex);
+    logger.exiting = 1;
+    pthread_cond_signal(&logger.cond);
+    pthread_mutex_unlock(&logger.mutex);
+    pthread_join(logger.writer, NULL);
+    logger.writer_running = 0;
+}
+
+//records logged by a process that ends with exit() still reach the file
+static void close_at_exit(void){
+    close_debug_file();
+}
+
+void open_debug_file(char *filename){
+    static int registered = 0;
+    logger.file = fopen(filename, "w");
+    if(logger.file == NULL){
+        perror(filename);
+        return;
+    }
+    init_sync();
+    atomic_store(&logger.open, 1);
+    start_writer();
+    if(!registered){
+        atexit(close_at_exit);
+        registered = 1;
+    }
+}
+
+void close_debug_file(){
+    if(logger.file == NULL){
+        return;
+    }
+    atomic_store(&logger.open, 0);
+    stop_writer();
+    pthread_mutex_lock(&logger.mutex);
+    drain();
+    pthread_mutex_unlock(&logger.mutex);
+    long dropped = logger.dropped;
+    for(log_ring_t *ring = atomic_load(&logger.rings); ring != NULL; ring = ring->next){
+        dropped += atomic_load(&ring->dropped);
+    }
+    if(dropped > 0){
+        fprintf(logger.file, "LOG dropped=%ld records\n", dropped);
+    }
+    fclose(logger.file);
+    logger.file = NULL;
+    free(logger.buffer);
+    logger.buffer = NULL;
+    logger.buffer_size = 0;
+    pthread_mutex_destroy(&logger.mutex);
+    pthread_cond_destroy(&logger.cond);
+}
+
+void log_before_fork(void){
+    stop_writer();
+}
+
+void log_after_fork(int child){
+    if(logger.file == NULL){
+        return;
+    }
+    if(child){
+        //the parent's threads are gone, only their memory was copied, their rings are empty
+        init_sync();
+        for(log_ring_t *ring = atomic_load(&logger.rings); ring != NULL; ring = ring->next){
+            if(ring != thread_ring){
+                atomic_store(&ring->orphaned, 1);
+            }
+        }
+    }
+    if(atomic_load(&logger.open)){
+        start_writer();
+    }
+}
@@ -0,0 +1,240 @@
+#include "lvlb.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+//names are kept NUL terminated in the arena, pacman_file is a fixed buffer
+static char *take_name(view_reader_t *r, arena_t *arena){
+    int32_t len = view_take_i32(r);
+    const char *bytes = len >= 0 && len < MAX_FILENAME ? view_take(r, len) : NULL;
+    if(bytes == NULL){
+        r->error = 1;
+        return NULL;
+    }
+    char *name = arena_alloc(arena, len +1);
+    if(name == NULL){
+        r->error = 1;
+        return NULL;
+    }
+    memcpy(name, bytes, len);
+    return name;
+}
+
+// bytes each record takes in the file, a count is checked against what is left before anything is allocated
+#define MOVE_BYTES (3 * sizeof(int32_t))
+#define AGENT_BYTES (4 * sizeof(int32_t))
+#define NAME_MIN_BYTES sizeof(int32_t)
+
+//whether count records of record bytes can still be in the view
+static int fits(const view_reader_t *r, int32_t count, size_t record){
+    return count >= 0 && (size_t)count <= (r->view->size - r->off) / record;
+}
+
+static command_t *take_moves(view_reader_t *r, arena_t *arena, int n_moves){
+    if(n_moves > 0 && !fits(r, n_moves, MOVE_BYTES)){
+        r->error = 1;
+        return NULL;
+    }
+    command_t *moves = arena_alloc(arena, (size_t)(n_moves > 0 ? n_moves : 1) * sizeof(command_t));
+    if(moves == NULL){
+        r->error = 1;
+        return NULL;
+    }
+    for(int m = 0; m < n_moves && !r->error; m++){
+        moves[m].command = (char)view_take_i32(r);
+        moves[m].turns = view_take_i32(r);
+        moves[m].turns_left = view_take_i32(r);
+    }
+    return moves;
+}
+
+int lvlb_is_binary(const file_view_t *view){
+    return view->size >= 4 && memcmp(view->data, LVLB_MAGIC, 4) == 0;
+}
+
+int lvlb_load(board_t *board, const file_view_t *view, int points){
+    view_reader_t r = {view, 4, 0};
+    board->dirty = NULL;
+    board->row_walls = board->col_walls = NULL;
+    board->row_agents = NULL;
+    board->col_agents = NULL;
+    int32_t version = view_take_i32(&r);
+    if(version != LVLB_VERSION){
+        fprintf(stderr, "level error: compiled level version %d, expected %d\n", version, LVLB_VERSION);
+        return -1;
+    }
+    board->width = view_take_i32(&r);
+    board->height = view_take_i32(&r);
+    board->tempo = view_take_i32(&r);
+    board->n_pacmans = view_take_i32(&r);
+    board->n_ghosts = view_take_i32(&r);
+    if(r.error || board->width <= 0 || board->height <= 0 || board->n_pacmans < 1 || board->n_ghosts < 0 ||
+       !fits(&r, board->n_pacmans, AGENT_BYTES) || !fits(&r, board->n_ghosts, AGENT_BYTES + NAME_MIN_BYTES)){
+        fprintf(stderr, "level error: bad compiled level header\n");
+        return -1;
+    }
+
+    char *pacman_file = take_name(&r, &board->arena);
+    if(pacman_file != NULL){
+        snprintf(board->pacman_file, sizeof(board->pacman_file), "%s", pacman_file);
+    }
+    board->pacmans = arena_alloc(&board->arena, board->n_pacmans * sizeof(pacman_t));
+    board->ghosts = arena_alloc(&board->arena, board->n_ghosts * sizeof(ghost_t));
+    board->ghosts_files = arena_alloc(&board->arena, board->n_ghosts * sizeof(char *));
+    if(board->pacmans == NULL || (board->n_ghosts > 0 && (board->ghosts == NULL || board->ghosts_files == NULL))){
+        return -1;
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        board->ghosts_files[g] = take_name(&r, &board->arena);
+    }
+
+    for(int p = 0; p < board->n_pacmans; p++){
+        pacman_t *pac = &board->pacmans[p];
+        pac->pos_x = view_take_i32(&r);
+        pac->pos_y = view_take_i32(&r);
+        pac->passo = view_take_i32(&r);
+        pac->waiting = pac->passo;
+        pac->n_moves = view_take_i32(&r);
+        pac->alive = 1;
+        pac->points = points;
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        ghost_t *ghost = &board->ghosts[g];
+        ghost->pos_x = view_take_i32(&r);
+        ghost->pos_y = view_take_i32(&r);
+        ghost->passo = view_take_i32(&r);
+        ghost->waiting = ghost->passo;
+        ghost->n_moves = view_take_i32(&r);
+    }
+    for(int p = 0; p < board->n_pacmans && !r.error; p++){
+        board->pacmans[p].moves = take_moves(&r, &board->arena, board->pacmans[p].n_moves);
+    }
+    for(int g = 0; g < board->n_ghosts && !r.error; g++){
+        board->ghosts[g].moves = take_moves(&r, &board->arena, board->ghosts[g].n_moves);
+    }
+
+    size_t cells = (size_t)board->width * board->height;
+    const void *grid = view_take(&r, cells * sizeof(board_pos_t));
+    if(r.error){
+        fprintf(stderr, "level error: compiled level is truncated\n");
+        return -1;
+    }
+    board->board = arena_alloc(&board->arena, cells * sizeof(board_pos_t));
+    if(board->board == NULL){
+        return -1;
+    }
+    memcpy(board->board, grid, cells * sizeof(board_pos_t));
+
+    //agents must sit on the board, the tables and the agent index trust these
+    for(int p = 0; p < board->n_pacmans; p++){
+        pacman_t *pac = &board->pacmans[p];
+        if(pac->pos_x < 0 || pac->pos_x >= board->width || pac->pos_y < 0 || pac->pos_y >= board->height || pac->n_moves < 0){
+            fprintf(stderr, "level error: compiled pacman %d is outside the board\n", p);
+            return -1;
+        }
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        ghost_t *ghost = &board->ghosts[g];
+        if(ghost->pos_x < 0 || ghost->pos_x >= board->width || ghost->pos_y < 0 || ghost->pos_y >= board->height || ghost->n_moves < 0){
+            fprintf(stderr, "level error: compiled ghost %d is outside the board\n", g);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// growing output buffer for lvlb_write
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+    int error;
+} writer_t;
+
+static void put(writer_t *w, const void *bytes, size_t size){
+    if(w->error) return;
+    if(w->size + size > w->capacity){
+        size_t capacity = w->capacity ? w->capacity : 4096;
+        while(capacity < w->size + size) capacity *= 2;
+        char *data = realloc(w->data, capacity);
+        if(data == NULL){
+            w->error = 1;
+            return;
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+    memcpy(w->data + w->size, bytes, size);
+    w->size += size;
+}
+
+static void put_i32(writer_t *w, int32_t value){
+    put(w, &value, sizeof(value));
+}
+
+static void put_name(writer_t *w, const char *name){
+    int32_t len = name != NULL ? (int32_t)strlen(name) : 0;
+    put_i32(w, len);
+    put(w, name, len);
+}
+
+static void put_moves(writer_t *w, const command_t *moves, int n_moves){
+    for(int m = 0; m < n_moves; m++){
+        put_i32(w, moves[m].command);
+        put_i32(w, moves[m].turns);
+        put_i32(w, moves[m].turns_left);
+    }
+}
+
+int lvlb_write(const board_t *board, int fd){
+    writer_t w = {NULL, 0, 0, 0};
+    put(&w, LVLB_MAGIC, 4);
+    put_i32(&w, LVLB_VERSION);
+    put_i32(&w, board->width);
+    put_i32(&w, board->height);
+    put_i32(&w, board->tempo);
+    put_i32(&w, board->n_pacmans);
+    put_i32(&w, board->n_ghosts);
+    put_name(&w, board->pacman_file);
+    for(int g = 0; g < board->n_ghosts; g++){
+        put_name(&w, board->ghosts_files[g]);
+    }
+    for(int p = 0; p < board->n_pacmans; p++){
+        put_i32(&w, board->pacmans[p].pos_x);
+        put_i32(&w, board->pacmans[p].pos_y);
+        put_i32(&w, board->pacmans[p].passo);
+        put_i32(&w, board->pacmans[p].n_moves);
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        put_i32(&w, board->ghosts[g].pos_x);
+        put_i32(&w, board->ghosts[g].pos_y);
+        put_i32(&w, board->ghosts[g].passo);
+        put_i32(&w, board->ghosts[g].n_moves);
+    }
+    for(int p = 0; p < board->n_pacmans; p++){
+        put_moves(&w, board->pacmans[p].moves, board->pacmans[p].n_moves);
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        put_moves(&w, board->ghosts[g].moves, board->ghosts[g].n_moves);
+    }
+    put(&w, board->board, (size_t)board->width * board->height * sizeof(board_pos_t));
+    if(w.error){
+        free(w.data);
+        fprintf(stderr, "compiled level: out of memory\n");
+        return -1;
+    }
+
+    size_t done = 0;
+    while(done < w.size){
+        ssize_t written = write(fd, w.data + done, w.size - done);
+        if(written < 0){
+            perror("write");
+            free(w.data);
+            return -1;
+        }
+        done += written;
+    }
+    free(w.data);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "render.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+//moves what was published into the front buffer, the renderer mutex must be held
+static int take_frame(renderer_t *renderer){
+    renderer->pending = 0;
+    if(frame_take(&renderer->shown, &renderer->published) == -1){
+        fprintf(stderr, "render: out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+//sends the front buffer to the terminal, no lock is held
+static void show_frame(renderer_t *renderer){
+    trace_begin("draw");
+    stats_start(draw_start);
+    draw_frame(&renderer->shown);
+    stats_stop(STAT_DRAW, draw_start);
+    trace_end("draw");
+    trace_begin("refresh");
+    stats_start(refresh_start);
+    refresh_screen();
+    stats_stop(STAT_REFRESH, refresh_start);
+    trace_end("refresh");
+}
+
+static void *render_thread(void *arg){
+    renderer_t *renderer = arg;
+    trace_thread("render");
+    pthread_mutex_lock(&renderer->mutex);
+    while(1){
+        while(!renderer->pending && !renderer->stopping){
+            pthread_cond_wait(&renderer->cond, &renderer->mutex);
+        }
+        if(!renderer->pending){
+            break;
+        }
+        int draw = take_frame(renderer) == 0;
+        pthread_mutex_unlock(&renderer->mutex);
+
+        //terminal I/O happens with no lock held, the game can publish meanwhile
+        if(draw){
+            show_frame(renderer);
+        }
+
+        pthread_mutex_lock(&renderer->mutex);
+        if(draw){
+            renderer->frames_drawn++;
+        }
+    }
+    pthread_mutex_unlock(&renderer->mutex);
+    return NULL;
+}
+
+void renderer_init(renderer_t *renderer){
+    pthread_mutex_init(&renderer->mutex, NULL);
+    pthread_cond_init(&renderer->cond, NULL);
+    frame_init(&renderer->published);
+    frame_init(&renderer->shown);
+    renderer->pending = 0;
+    renderer->running = 0;
+    renderer->stopping = 0;
+    renderer->frames_published = 0;
+    renderer->frames_drawn = 0;
+}
+
+void renderer_start(renderer_t *renderer){
+    if(renderer->running){
+        return;
+    }
+    renderer->stopping = 0;
+    if(pthread_create(&renderer->thread, NULL, render_thread, renderer) != 0){
+        //no thread to spare, renderer_publish draws instead
+        return;
+    }
+    renderer->running = 1;
+}
+
+void renderer_stop(renderer_t *renderer){
+    if(!renderer->running){
+        return;
+    }
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->stopping = 1;
+    pthread_cond_signal(&renderer->cond);
+    pthread_mutex_unlock(&renderer->mutex);
+    pthread_join(renderer->thread, NULL);
+    renderer->running = 0;
+}
+
+void renderer_destroy(renderer_t *renderer){
+    debug("RENDER published=%ld drawn=%ld\n", renderer->frames_published, renderer->frames_drawn);
+    frame_free(&renderer->published);
+    frame_free(&renderer->shown);
+    pthread_mutex_destroy(&renderer->mutex);
+    pthread_cond_destroy(&renderer->cond);
+}
+
+void renderer_publish(renderer_t *renderer, board_t *board, int mode){
+    trace_begin("publish");
+    board_lock(board);
+    pthread_mutex_lock(&renderer->mutex);
+    if(frame_publish(&renderer->published, board, mode) == -1){
+        pthread_mutex_unlock(&renderer->mutex);
+        board_unlock(board);
+        trace_end("publish");
+        fprintf(stderr, "render: out of memory\n");
+        return;
+    }
+    renderer->pending = 1;
+    renderer->frames_published++;
+    pthread_cond_signal(&renderer->cond);
+    pthread_mutex_unlock(&renderer->mutex);
+    board_unlock(board);
+    trace_end("publish");
+
+    if(!renderer->running){
+        pthread_mutex_lock(&renderer->mutex);
+        int draw = take_frame(renderer) == 0;
+        pthread_mutex_unlock(&renderer->mutex);
+        if(draw){
+            show_frame(renderer);
+            renderer->frames_drawn++;
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#include "replay.h"
+#include "file_manager.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const session_format_t replay_format = {REPLAY_MAGIC, REPLAY_VERSION, 0, "replay"};
+
+int replay_record_start(replay_t *replay, const char *path, const session_t *session){
+    replay->events = NULL;
+    replay->n_events = 0;
+    replay->next = 0;
+    replay->diverged = -1;
+    replay->file = fopen(path, "wb");
+    if(replay->file == NULL){
+        perror(path);
+        return -1;
+    }
+    session_write_header(replay->file, &replay_format, session);
+    if(fflush(replay->file) != 0){
+        perror(path);
+        fclose(replay->file);
+        replay->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void replay_record(replay_t *replay, long tick, int type, int value){
+    if(replay->file == NULL){
+        return;
+    }
+    replay_event_t event = {(int32_t)tick, type, value};
+    //a few bytes per key, flushed right away so a crash still leaves a log to replay
+    if(fwrite(&event, sizeof(event), 1, replay->file) != 1 || fflush(replay->file) != 0){
+        perror("record");
+        fclose(replay->file);
+        replay->file = NULL;
+    }
+}
+
+void replay_record_stop(replay_t *replay){
+    if(replay->file != NULL && fclose(replay->file) != 0){
+        perror("record");
+    }
+    replay->file = NULL;
+}
+
+//reads the header and copies out the events, lvl_files is allocated here
+static int read_log(view_reader_t *r, replay_t *replay, session_t *session){
+    if(session_read_header(r, &replay_format, session) == -1){
+        return -1;
+    }
+
+    //a log cut short by a crash ends in the middle of an event, that part is left out
+    replay->n_events = (int)((r->view->size - r->off) / sizeof(replay_event_t));
+    replay->events = malloc((replay->n_events > 0 ? replay->n_events : 1) * sizeof(replay_event_t));
+    if(replay->events == NULL){
+        perror("replay");
+        free_lvl_files(session->lvl_files, session->count);
+        return -1;
+    }
+    memcpy(replay->events, r->view->data + r->off, replay->n_events * sizeof(replay_event_t));
+    return 0;
+}
+
+int replay_open(replay_t *replay, const char *path, session_t *session){
+    replay->file = NULL;
+    replay->events = NULL;
+    replay->n_events = 0;
+    replay->next = 0;
+    replay->diverged = -1;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        perror(path);
+        return -1;
+    }
+    arena_t arena;
+    arena_init(&arena, ARENA_BLOCK_SIZE);
+    file_view_t view;
+    int result = open_view(fd, &arena, &view);
+    close(fd);
+    if(result == 0){
+        view_reader_t r = {&view, 0, 0};
+        result = read_log(&r, replay, session);
+        close_view(&view);
+    }
+    arena_release(&arena);
+    return result;
+}
+
+char replay_key(replay_t *replay, long tick){
+    if(replay->next >= replay->n_events || replay->diverged != -1){
+        //nothing left that can be played, the session ends as if the player quit
+        return 'Q';
+    }
+    replay_event_t *event = &replay->events[replay->next];
+    if(event->tick < tick){
+        //the event was due at a tick this replay never took a key on
+        replay->diverged = tick;
+        return 'Q';
+    }
+    if(event->type != REPLAY_KEY || event->tick > tick){
+        return '\0';
+    }
+    replay->next++;
+    return (char)event->value;
+}
+
+void replay_check(replay_t *replay, long tick, int type, int value){
+    replay_event_t *event = replay->next < replay->n_events ? &replay->events[replay->next] : NULL;
+    if(event != NULL && event->tick == tick && event->type == type && event->value == value){
+        replay->next++;
+        return;
+    }
+    if(replay->diverged == -1){
+        replay->diverged = tick;
+    }
+}
+
+void replay_close(replay_t *replay){
+    free(replay->events);
+    replay->events = NULL;
+    replay->n_events = 0;
+}
@@ -0,0 +1,48 @@
+#include "rng.h"
+
+// splitmix64 step, spreads a 64 bit value over the whole state
+static uint64_t splitmix64(uint64_t *x){
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint32_t rotl(uint32_t x, int k){
+    return (x << k) | (x >> (32 - k));
+}
+
+uint64_t rng_mix(uint64_t seed, uint64_t value){
+    uint64_t x = seed ^ (value * 0xd1342543de82ef95ULL);
+    return splitmix64(&x);
+}
+
+void rng_seed(rng_t *rng, uint64_t seed, uint64_t stream){
+    uint64_t x = rng_mix(seed, stream);
+    uint64_t a = splitmix64(&x);
+    uint64_t b = splitmix64(&x);
+    rng->s[0] = (uint32_t)a;
+    rng->s[1] = (uint32_t)(a >> 32);
+    rng->s[2] = (uint32_t)b;
+    rng->s[3] = (uint32_t)(b >> 32);
+    //an all zero state would only ever return zeros
+    if((a | b) == 0) rng->s[0] = 1;
+}
+
+uint32_t rng_next(rng_t *rng){
+    uint32_t *s = rng->s;
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+}
+
+uint32_t rng_below(rng_t *rng, uint32_t n){
+    //multiply and shift keeps the high bits, the best ones of this generator
+    return (uint32_t)(((uint64_t)rng_next(rng) * n) >> 32);
+}
@@ -0,0 +1,230 @@
+#include "savefile.h"
+#include "file_manager.h"
+#include "lvlb.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// dynamic state of an agent, everything else is in the compiled level
+typedef struct {
+    int32_t alive, points, current_move, waiting;
+    uint32_t rng[4];
+} pacman_record_t;
+
+typedef struct {
+    int32_t current_move, waiting, charged;
+    uint32_t rng[4];
+} ghost_record_t;
+
+static const session_format_t save_format = {SAVEFILE_MAGIC, SAVEFILE_VERSION, 1, "save"};
+
+static void put_name(FILE *file, const char *name){
+    int32_t len = (int32_t)strlen(name);
+    fwrite(&len, sizeof(len), 1, file);
+    fwrite(name, 1, len, file);
+}
+
+void session_write_header(FILE *file, const session_format_t *format, const session_t *session){
+    int32_t version = format->version;
+    int32_t level = session->level;
+    int32_t count = session->count;
+    fwrite(format->magic, 1, 4, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&session->seed, sizeof(session->seed), 1, file);
+    if(format->has_level){
+        fwrite(&level, sizeof(level), 1, file);
+    }
+    fwrite(&count, sizeof(count), 1, file);
+    put_name(file, session->level_dir);
+    for(int i = 0; i < session->count; i++){
+        put_name(file, session->lvl_files[i]);
+    }
+}
+
+int save_game(const char *path, const board_t *board, const session_t *session){
+    char tmp_path[2 * MAX_FILENAME];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if(file == NULL){
+        perror(tmp_path);
+        return -1;
+    }
+
+    session_write_header(file, &save_format, session);
+
+    int32_t agents[2] = {board->n_pacmans, board->n_ghosts};
+    fwrite(agents, sizeof(int32_t), 2, file);
+    for(int p = 0; p < board->n_pacmans; p++){
+        const pacman_t *pac = &board->pacmans[p];
+        pacman_record_t record = {pac->alive, pac->points, pac->current_move, pac->waiting, {0}};
+        memcpy(record.rng, pac->rng.s, sizeof(record.rng));
+        fwrite(&record, sizeof(record), 1, file);
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        const ghost_t *ghost = &board->ghosts[g];
+        ghost_record_t record = {ghost->current_move, ghost->waiting, ghost->charged, {0}};
+        memcpy(record.rng, ghost->rng.s, sizeof(record.rng));
+        fwrite(&record, sizeof(record), 1, file);
+    }
+
+    //the compiled level goes straight to the file descriptor after what is buffered
+    int failed = fflush(file) != 0 || lvlb_write(board, fileno(file)) == -1;
+    if(fclose(file) != 0 || failed){
+        perror(path);
+        unlink(tmp_path);
+        return -1;
+    }
+    if(rename(tmp_path, path) == -1){
+        perror(path);
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+//copies a length prefixed name into out, which holds size bytes
+static void take_name(view_reader_t *r, char *out, size_t size){
+    int32_t len = view_take_i32(r);
+    const char *bytes = len >= 0 && (size_t)len < size ? view_take(r, len) : NULL;
+    if(bytes == NULL){
+        r->error = 1;
+        return;
+    }
+    memcpy(out, bytes, len);
+    out[len] = '\0';
+}
+
+int session_read_header(view_reader_t *r, const session_format_t *format, session_t *session){
+    const char *magic = view_take(r, 4);
+    if(magic == NULL || memcmp(magic, format->magic, 4) != 0){
+        fprintf(stderr, "%s error: not a %s file\n", format->what, format->what);
+        return -1;
+    }
+    int32_t version = view_take_i32(r);
+    if(version != format->version){
+        fprintf(stderr, "%s error: version %d, expected %d\n", format->what, version, format->version);
+        return -1;
+    }
+    const void *seed = view_take(r, sizeof(session->seed));
+    if(seed != NULL){
+        memcpy(&session->seed, seed, sizeof(session->seed));
+    }
+    session->level = format->has_level ? view_take_i32(r) : 0;
+    session->count = view_take_i32(r);
+    //every name takes at least its length, a count the file cannot hold is not allocated
+    if(r->error || session->count <= 0 || (size_t)session->count > (r->view->size - r->off) / sizeof(int32_t)
+            || session->level < 0 || session->level >= session->count){
+        fprintf(stderr, "%s error: bad header\n", format->what);
+        return -1;
+    }
+    take_name(r, session->level_dir, sizeof(session->level_dir));
+    session->lvl_files = calloc(session->count, sizeof(char *));
+    for(int i = 0; session->lvl_files != NULL && i < session->count && !r->error; i++){
+        char name[MAX_FILENAME];
+        take_name(r, name, sizeof(name));
+        if(!r->error && (session->lvl_files[i] = strdup(name)) == NULL){
+            r->error = 1;
+        }
+    }
+    if(session->lvl_files == NULL || r->error){
+        fprintf(stderr, "%s error: truncated header\n", format->what);
+        if(session->lvl_files != NULL){
+            free_lvl_files(session->lvl_files, session->count);
+            session->lvl_files = NULL;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int read_save_session(const char *path, session_t *session){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        perror(path);
+        return -1;
+    }
+    arena_t arena;
+    arena_init(&arena, ARENA_BLOCK_SIZE);
+    file_view_t view;
+    int result = open_view(fd, &arena, &view);
+    close(fd);
+    if(result == 0){
+        view_reader_t r = {&view, 0, 0};
+        result = session_read_header(&r, &save_format, session);
+        close_view(&view);
+    }
+    arena_release(&arena);
+    return result;
+}
+
+int load_saved_level(const char *path, board_t *board){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        perror(path);
+        return -1;
+    }
+    file_view_t view;
+    int result = open_view(fd, &board->arena, &view);
+    close(fd);
+    if(result == -1){
+        return -1;
+    }
+
+    session_t session = {0};
+    view_reader_t r = {&view, 0, 0};
+    result = session_read_header(&r, &save_format, &session);
+    if(result == 0){
+        snprintf(board->level_name, sizeof(board->level_name), "%s", session.lvl_files[session.level]);
+        free_lvl_files(session.lvl_files, session.count);
+    }
+    int32_t n_pacmans = view_take_i32(&r);
+    int32_t n_ghosts = view_take_i32(&r);
+    //records may be unaligned in the file, they are copied out one by one
+    const unsigned char *pacmans = n_pacmans >= 0 ? view_take(&r, n_pacmans * sizeof(pacman_record_t)) : NULL;
+    const unsigned char *ghosts = n_ghosts >= 0 ? view_take(&r, n_ghosts * sizeof(ghost_record_t)) : NULL;
+    if(result == 0 && (r.error || pacmans == NULL || ghosts == NULL)){
+        fprintf(stderr, "save error: truncated agents\n");
+        result = -1;
+    }
+
+    //what is left is the compiled level
+    file_view_t level = {view.data + r.off, view.size - r.off, NULL, 0};
+    if(result == 0 && (!lvlb_is_binary(&level) || lvlb_load(board, &level, 0) == -1)){
+        fprintf(stderr, "save error: bad level\n");
+        result = -1;
+    }
+    if(result == 0 && (board->n_pacmans != n_pacmans || board->n_ghosts != n_ghosts)){
+        fprintf(stderr, "save error: agents do not match the level\n");
+        result = -1;
+    }
+    for(int p = 0; result == 0 && p < n_pacmans; p++){
+        pacman_record_t record;
+        memcpy(&record, pacmans + p * sizeof(record), sizeof(record));
+        pacman_t *pac = &board->pacmans[p];
+        pac->alive = record.alive;
+        pac->points = record.points;
+        pac->current_move = record.current_move;
+        pac->waiting = record.waiting;
+        memcpy(pac->rng.s, record.rng, sizeof(record.rng));
+    }
+    for(int g = 0; result == 0 && g < n_ghosts; g++){
+        ghost_record_t record;
+        memcpy(&record, ghosts + g * sizeof(record), sizeof(record));
+        ghost_t *ghost = &board->ghosts[g];
+        ghost->current_move = record.current_move;
+        ghost->waiting = record.waiting;
+        ghost->charged = record.charged;
+        memcpy(ghost->rng.s, record.rng, sizeof(record.rng));
+    }
+    close_view(&view);
+    board->seed = rng_mix(session.seed, session.level);
+    if(result == 0){
+        result = build_level_tables(board);
+    }
+    if(result == -1){
+        arena_reset(&board->arena);
+    }
+    return result;
+}
@@ -0,0 +1,140 @@
+#include "snapshot.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+void snapshot_store_init(snapshot_store_t *store){
+    store->slots = NULL;
+    store->n_slots = 0;
+    store->capacity = 0;
+}
+
+void snapshot_store_free(snapshot_store_t *store){
+    for(int i = 0; i < store->n_slots; i++){
+        free(store->slots[i].data);
+    }
+    free(store->slots);
+    snapshot_store_init(store);
+}
+
+snapshot_t *snapshot_find(snapshot_store_t *store, const char *name){
+    for(int i = 0; i < store->n_slots; i++){
+        if(store->slots[i].size > 0 && strcmp(store->slots[i].name, name) == 0){
+            return &store->slots[i];
+        }
+    }
+    return NULL;
+}
+
+//finds the slot by name even when empty, or adds it
+static snapshot_t *get_slot(snapshot_store_t *store, const char *name){
+    for(int i = 0; i < store->n_slots; i++){
+        if(strcmp(store->slots[i].name, name) == 0){
+            return &store->slots[i];
+        }
+    }
+    if(store->n_slots == store->capacity){
+        int capacity = store->capacity ? store->capacity * 2 : 4;
+        snapshot_t *slots = realloc(store->slots, capacity * sizeof(snapshot_t));
+        if(slots == NULL){
+            return NULL;
+        }
+        store->slots = slots;
+        store->capacity = capacity;
+    }
+    snapshot_t *snap = &store->slots[store->n_slots++];
+    memset(snap, 0, sizeof(*snap));
+    snprintf(snap->name, sizeof(snap->name), "%s", name);
+    return snap;
+}
+
+//bytes of every move script of the level
+static size_t script_bytes(const board_t *board){
+    size_t bytes = 0;
+    for(int p = 0; p < board->n_pacmans; p++){
+        bytes += board->pacmans[p].n_moves * sizeof(command_t);
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        bytes += board->ghosts[g].n_moves * sizeof(command_t);
+    }
+    return bytes;
+}
+
+int snapshot_save(snapshot_store_t *store, const char *name, const board_t *board, int level){
+    snapshot_t *snap = get_slot(store, name);
+    if(snap == NULL){
+        return -1;
+    }
+    size_t cells = (size_t)board->width * board->height * sizeof(board_pos_t);
+    size_t pacmans = board->n_pacmans * sizeof(pacman_t);
+    size_t ghosts = board->n_ghosts * sizeof(ghost_t);
+    size_t size = cells + pacmans + ghosts + script_bytes(board);
+    //saving again into the same slot reuses its buffer
+    if(size > snap->capacity){
+        unsigned char *data = realloc(snap->data, size);
+        if(data == NULL){
+            return -1;
+        }
+        snap->data = data;
+        snap->capacity = size;
+    }
+    memcpy(snap->data, board->board, cells);
+    memcpy(snap->data + cells, board->pacmans, pacmans);
+    memcpy(snap->data + cells + pacmans, board->ghosts, ghosts);
+    //'T' moves count down in the scripts themselves
+    unsigned char *moves = snap->data + cells + pacmans + ghosts;
+    for(int p = 0; p < board->n_pacmans; p++){
+        memcpy(moves, board->pacmans[p].moves, board->pacmans[p].n_moves * sizeof(command_t));
+        moves += board->pacmans[p].n_moves * sizeof(command_t);
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        memcpy(moves, board->ghosts[g].moves, board->ghosts[g].n_moves * sizeof(command_t));
+        moves += board->ghosts[g].n_moves * sizeof(command_t);
+    }
+    snap->size = size;
+    snap->level = level;
+    snap->width = board->width;
+    snap->height = board->height;
+    snap->n_pacmans = board->n_pacmans;
+    snap->n_ghosts = board->n_ghosts;
+    return 0;
+}
+
+void snapshot_drop(snapshot_store_t *store, const char *name){
+    snapshot_t *snap = snapshot_find(store, name);
+    if(snap != NULL){
+        snap->size = 0; //the buffer stays for the next save
+    }
+}
+
+int snapshot_restore(const snapshot_t *snap, board_t *board){
+    size_t cells = (size_t)board->width * board->height * sizeof(board_pos_t);
+    size_t agents = board->n_pacmans * sizeof(pacman_t) + board->n_ghosts * sizeof(ghost_t);
+    if(snap->width != board->width || snap->height != board->height ||
+       snap->n_pacmans != board->n_pacmans || snap->n_ghosts != board->n_ghosts ||
+       snap->size != cells + agents + script_bytes(board)){
+        fprintf(stderr, "snapshot '%s' does not match the loaded level\n", snap->name);
+        return -1;
+    }
+    const unsigned char *pacmans = snap->data + cells;
+    const unsigned char *ghosts = pacmans + board->n_pacmans * sizeof(pacman_t);
+    memcpy(board->board, snap->data, cells);
+    //the scripts belong to the loaded level, everything else comes from the snapshot
+    const unsigned char *scripts = snap->data + cells + agents;
+    for(int p = 0; p < board->n_pacmans; p++){
+        command_t *moves = board->pacmans[p].moves;
+        memcpy(&board->pacmans[p], pacmans + p * sizeof(pacman_t), sizeof(pacman_t));
+        board->pacmans[p].moves = moves;
+        memcpy(moves, scripts, board->pacmans[p].n_moves * sizeof(command_t));
+        scripts += board->pacmans[p].n_moves * sizeof(command_t);
+    }
+    for(int g = 0; g < board->n_ghosts; g++){
+        command_t *moves = board->ghosts[g].moves;
+        memcpy(&board->ghosts[g], ghosts + g * sizeof(ghost_t), sizeof(ghost_t));
+        board->ghosts[g].moves = moves;
+        memcpy(moves, scripts, board->ghosts[g].n_moves * sizeof(command_t));
+        scripts += board->ghosts[g].n_moves * sizeof(command_t);
+    }
+    board_index_agents(board);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "stats.h"
+
+#if STATS
+
+#include "log.h"
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct {
+    atomic_long counts[STATS_BUCKETS];
+    atomic_llong max;
+    atomic_llong sum;
+} histogram_t;
+
+// plain copy of a histogram, what the percentiles are read from
+typedef struct {
+    long counts[STATS_BUCKETS];
+    long count;
+    long long max;
+    long long sum;
+} histogram_copy_t;
+
+static const char *names[STAT_COUNT] = {
+    "play_board", "move_pacman", "ghost_plan", "ghost_apply", "lock_wait", "draw_frame", "refresh_screen", "tick",
+};
+
+// filled by every thread while a level is played, emptied at its end
+static histogram_t level[STAT_COUNT];
+
+// everything since the start, only touched by the thread that ends the levels
+static histogram_copy_t total[STAT_COUNT];
+static long total_over_tempo;
+
+static int bucket_of(long long ns){
+    if(ns < 0){
+        ns = 0;
+    }
+    if(ns < (2LL << STATS_SUB_BITS)){
+        return (int)ns;
+    }
+    int msb = 63 - __builtin_clzll((unsigned long long)ns);
+    if(msb >= STATS_MAX_BITS){
+        return STATS_BUCKETS - 1;
+    }
+    //ns >> shift keeps the top STATS_SUB_BITS + 1 bits, from 2^SUB_BITS to 2^(SUB_BITS + 1) - 1
+    int shift = msb - STATS_SUB_BITS;
+    return (shift << STATS_SUB_BITS) + (int)(ns >> shift);
+}
+
+//highest time that lands in the bucket
+static long long bucket_top(int bucket){
+    if(bucket < (2 << STATS_SUB_BITS)){
+        return bucket;
+    }
+    int shift = (bucket >> STATS_SUB_BITS) - 1;
+    long long top_bits = (bucket & ((1 << STATS_SUB_BITS) - 1)) + (1 << STATS_SUB_BITS);
+    return ((top_bits + 1) << shift) - 1;
+}
+
+void stats_add(stat_t stat, long long ns){
+    histogram_t *h = &level[stat];
+    atomic_fetch_add_explicit(&h->counts[bucket_of(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, ns, memory_order_relaxed);
+    long long max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while(ns > max && !atomic_compare_exchange_weak_explicit(&h->max, &max, ns, memory_order_relaxed, memory_order_relaxed)){
+    }
+}
+
+//time at or under which fraction of the samples are, 0 without samples
+static long long percentile(const histogram_copy_t *h, double fraction){
+    long rank = (long)(fraction * h->count + 0.999999);
+    if(rank < 1){
+        rank = 1;
+    }
+    long seen = 0;
+    for(int b = 0; b < STATS_BUCKETS; b++){
+        seen += h->counts[b];
+        if(seen >= rank){
+            long long top = bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+static void log_histogram(const char *scope, stat_t stat, const histogram_copy_t *h, long over_tempo){
+    if(h->count == 0){
+        return;
+    }
+    char extra[64] = "";
+    if(stat == STAT_TICK){
+        snprintf(extra, sizeof(extra), " over_tempo=%ld", over_tempo);
+    }
+    log_at(LOG_LEVEL_INFO, "STATS %s %s count=%ld p50=%lld p99=%lld max=%lld mean=%lld%s ns\n", scope, names[stat],
+           h->count, percentile(h, 0.50), percentile(h, 0.99), h->max, h->sum / h->count, extra);
+}
+
+//empties a level histogram into copy and adds it to the totals, returns the samples at or over tempo_ns
+static long take_level(stat_t stat, histogram_copy_t *copy, long long tempo_ns){
+    //the render thread may still be adding, what it adds meanwhile goes to the next level
+    memset(copy, 0, sizeof(*copy));
+    long over_tempo = 0;
+    for(int b = 0; b < STATS_BUCKETS; b++){
+        copy->counts[b] = atomic_exchange_explicit(&level[stat].counts[b], 0, memory_order_relaxed);
+        copy->count += copy->counts[b];
+        if(tempo_ns > 0 && bucket_top(b) >= tempo_ns){
+            over_tempo += copy->counts[b];
+        }
+        total[stat].counts[b] += copy->counts[b];
+    }
+    copy->max = atomic_exchange_explicit(&level[stat].max, 0, memory_order_relaxed);
+    copy->sum = atomic_exchange_explicit(&level[stat].sum, 0, memory_order_relaxed);
+    total[stat].count += copy->count;
+    total[stat].sum += copy->sum;
+    if(copy->max > total[stat].max){
+        total[stat].max = copy->max;
+    }
+    if(stat == STAT_TICK){
+        total_over_tempo += over_tempo;
+    }
+    return over_tempo;
+}
+
+void stats_level_end(const char *level_name, int tempo_ms){
+    static histogram_copy_t copy;
+    for(int s = 0; s < STAT_COUNT; s++){
+        long over_tempo = take_level(s, &copy, tempo_ms * 1000000LL);
+        log_histogram(level_name, s, &copy, over_tempo);
+    }
+}
+
+void stats_exit(void){
+    static histogram_copy_t copy;
+    for(int s = 0; s < STAT_COUNT; s++){
+        //frames drawn after the last level ended
+        take_level(s, &copy, 0);
+        log_histogram("total", s, &total[s], total_over_tempo);
+    }
+}
+
+#endif
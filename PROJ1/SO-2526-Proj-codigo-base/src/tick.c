@@ -0,0 +1,69 @@
+#include "tick.h"
+#include "stats.h"
+#include "tracer.h"
+
+#define NS_PER_SEC 1000000000L
+
+static long long timespec_ns(const struct timespec *ts){
+    return (long long)ts->tv_sec * NS_PER_SEC + ts->tv_nsec;
+}
+
+void tick_timeline_start(tick_timeline_t *timeline, int tempo_ms){
+    clock_gettime(CLOCK_MONOTONIC, &timeline->epoch);
+    timeline->period_ns = tempo_ms > 0 ? tempo_ms * 1000000L : 0;
+}
+
+void tick_pacer_init(tick_pacer_t *pacer){
+    pacer->tick = 0;
+    pacer->ticks = 0;
+    pacer->overruns = 0;
+    pacer->skipped = 0;
+    pacer->max_late_us = 0;
+}
+
+void tick_pacer_restart(tick_pacer_t *pacer){
+    pacer->tick = 0;
+}
+
+void tick_pacer_next(tick_pacer_t *pacer, const tick_timeline_t *timeline, struct timespec *deadline){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pacer->ticks++;
+    if(timeline->period_ns == 0){
+        *deadline = now;
+        return;
+    }
+
+    //deadlines are computed from the epoch, never from the end of the last tick, so nothing drifts
+    long long epoch = timespec_ns(&timeline->epoch);
+    long long elapsed = timespec_ns(&now) - epoch;
+    //how long after its deadline the work of the tick ended
+    stats_add(STAT_TICK, elapsed - (long long)pacer->tick * timeline->period_ns);
+    long next = pacer->tick + 1;
+    long reached = (long)(elapsed / timeline->period_ns);
+    if(reached >= next){
+        pacer->overruns++;
+        long late_us = (long)((elapsed - (long long)next * timeline->period_ns) / 1000);
+        if(late_us > pacer->max_late_us){
+            pacer->max_late_us = late_us;
+        }
+        //less than a period late runs right away, more waits for the next deadline still ahead
+        //instead of a burst of catch up ticks
+        if(reached > next){
+            pacer->skipped += reached - next + 1;
+            next = reached + 1;
+        }
+    }
+    pacer->tick = next;
+    long long due = epoch + (long long)next * timeline->period_ns;
+    deadline->tv_sec = due / NS_PER_SEC;
+    deadline->tv_nsec = due % NS_PER_SEC;
+}
+
+void tick_pacer_sleep(tick_pacer_t *pacer, const tick_timeline_t *timeline){
+    struct timespec deadline;
+    tick_pacer_next(pacer, timeline, &deadline);
+    trace_begin("sleep");
+    tick_sleep_until(&deadline);
+    trace_end("sleep");
+}
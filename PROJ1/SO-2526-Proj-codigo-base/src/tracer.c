@@ -0,0 +1,227 @@
+#include "tracer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+// bytes formatted before each write, an event line never spans two writes
+#define TEXT_SIZE 16384
+#define EVENT_TEXT_MAX 256
+
+typedef struct {
+    long long ts_ns;
+    const char *name;
+    char phase;             // 'B' and 'E' for slices, 'M' names the thread, 'P' names the process
+} trace_record_t;
+
+// events of one thread, only that thread touches it, and release_buffer once it exits
+typedef struct tracer_buffer {
+    trace_record_t records[TRACER_BUFFER_EVENTS];
+    int n_records;
+    int tid;
+    char name[32];
+    struct tracer_buffer *next;
+} tracer_buffer_t;
+
+int tracer_enabled = 0;
+
+static struct {
+    int fd;
+    pid_t owner;                // the process that opened the trace ends the JSON array
+    pthread_mutex_t mutex;      // the list of buffers and fd, held by every flush
+    tracer_buffer_t *buffers;
+    int next_tid;
+} tracer = {-1, 0, PTHREAD_MUTEX_INITIALIZER, NULL, 1};
+
+static _Thread_local tracer_buffer_t *thread_buffer;
+static pthread_key_t buffer_key;
+static pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+
+static long long now_ns(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void write_text(const char *text, size_t size){
+    //O_APPEND, every write lands whole at the end even with a forked child writing too
+    while(size > 0){
+        ssize_t written = write(tracer.fd, text, size);
+        if(written < 0){
+            perror("trace");
+            return;
+        }
+        text += written;
+        size -= written;
+    }
+}
+
+//writes the events of a buffer to the file and empties it
+static void flush_buffer(tracer_buffer_t *buffer){
+    char text[TEXT_SIZE];
+    size_t used = 0;
+    int pid = (int)getpid();
+    for(int i = 0; i < buffer->n_records; i++){
+        trace_record_t *record = &buffer->records[i];
+        if(used + EVENT_TEXT_MAX > sizeof(text)){
+            write_text(text, used);
+            used = 0;
+        }
+        int len;
+        if(record->phase == 'M' || record->phase == 'P'){
+            len = snprintf(text + used, EVENT_TEXT_MAX,
+                           "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                           record->phase == 'M' ? "thread_name" : "process_name", pid, buffer->tid, record->name);
+        }else{
+            len = snprintf(text + used, EVENT_TEXT_MAX, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d},\n",
+                           record->name, record->phase, record->ts_ns / 1000, record->ts_ns % 1000, pid, buffer->tid);
+        }
+        if(len > 0 && len < EVENT_TEXT_MAX){
+            used += len;
+        }
+    }
+    write_text(text, used);
+    buffer->n_records = 0;
+}
+
+//a thread that exits leaves its events in the file
+static void release_buffer(void *arg){
+    tracer_buffer_t *buffer = arg;
+    pthread_mutex_lock(&tracer.mutex);
+    if(tracer.fd >= 0){
+        flush_buffer(buffer);
+    }
+    for(tracer_buffer_t **link = &tracer.buffers; *link != NULL; link = &(*link)->next){
+        if(*link == buffer){
+            *link = buffer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&tracer.mutex);
+    free(buffer);
+}
+
+static void make_buffer_key(void){
+    pthread_key_create(&buffer_key, release_buffer);
+}
+
+//buffer of the calling thread, created the first time it records
+static tracer_buffer_t *get_buffer(void){
+    if(thread_buffer == NULL){
+        pthread_once(&buffer_key_once, make_buffer_key);
+        tracer_buffer_t *buffer = malloc(sizeof(tracer_buffer_t));
+        if(buffer == NULL){
+            return NULL;
+        }
+        buffer->n_records = 0;
+        buffer->name[0] = '\0';
+        pthread_mutex_lock(&tracer.mutex);
+        buffer->tid = tracer.next_tid++;
+        buffer->next = tracer.buffers;
+        tracer.buffers = buffer;
+        pthread_mutex_unlock(&tracer.mutex);
+        thread_buffer = buffer;
+        pthread_setspecific(buffer_key, buffer);
+    }
+    return thread_buffer;
+}
+
+static void push_record(tracer_buffer_t *buffer, char phase, const char *name){
+    if(buffer->n_records == TRACER_BUFFER_EVENTS){
+        //shows up in the trace as a gap in this thread, once the trace is closed the events are dropped
+        pthread_mutex_lock(&tracer.mutex);
+        if(tracer.fd >= 0){
+            flush_buffer(buffer);
+        }
+        buffer->n_records = 0;
+        pthread_mutex_unlock(&tracer.mutex);
+    }
+    trace_record_t *record = &buffer->records[buffer->n_records++];
+    record->ts_ns = now_ns();
+    record->name = name;
+    record->phase = phase;
+}
+
+void tracer_event(char phase, const char *name){
+    tracer_buffer_t *buffer = get_buffer();
+    if(buffer != NULL){
+        push_record(buffer, phase, name);
+    }
+}
+
+void tracer_thread(const char *name){
+    tracer_buffer_t *buffer = get_buffer();
+    if(buffer != NULL){
+        snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+        push_record(buffer, 'M', buffer->name);
+    }
+}
+
+static void close_at_exit(void){
+    tracer_close();
+}
+
+int tracer_open(const char *path){
+    tracer.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(tracer.fd < 0){
+        perror(path);
+        return -1;
+    }
+    tracer.owner = getpid();
+    //the JSON array format, a trace cut short by a crash still loads without the closing bracket
+    write_text("[\n", 2);
+    tracer_enabled = 1;
+    atexit(close_at_exit);
+    tracer_thread("main");
+    return 0;
+}
+
+void tracer_close(void){
+    if(tracer.fd < 0){
+        return;
+    }
+    tracer_enabled = 0;
+    pthread_mutex_lock(&tracer.mutex);
+    //threads that exited already wrote theirs, the buffers still listed belong to threads that may be recording
+    //right now (an exit() that did not join them), only the owner may touch a buffer, so their tails are dropped
+    if(thread_buffer != NULL){
+        flush_buffer(thread_buffer);
+    }
+    if(getpid() == tracer.owner){
+        char text[EVENT_TEXT_MAX];
+        int len = snprintf(text, sizeof(text), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"Pacmanist\"}}\n]\n",
+                           (int)tracer.owner);
+        write_text(text, len);
+    }
+    close(tracer.fd);
+    tracer.fd = -1;
+    pthread_mutex_unlock(&tracer.mutex);
+}
+
+void tracer_after_fork(const char *process_name){
+    if(!tracer_enabled){
+        return;
+    }
+    //the other threads were not copied, the parent writes what they and this thread recorded before the fork
+    pthread_mutex_init(&tracer.mutex, NULL);
+    tracer_buffer_t *buffer = tracer.buffers;
+    tracer.buffers = NULL;
+    while(buffer != NULL){
+        tracer_buffer_t *next = buffer->next;
+        if(buffer == thread_buffer){
+            buffer->n_records = 0;
+            buffer->next = NULL;
+            tracer.buffers = buffer;
+        }else{
+            free(buffer);
+        }
+        buffer = next;
+    }
+    if(thread_buffer != NULL){
+        push_record(thread_buffer, 'M', thread_buffer->name);
+        push_record(thread_buffer, 'P', process_name);
+    }
+}
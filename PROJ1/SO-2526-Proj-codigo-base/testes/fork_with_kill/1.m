@@ -1,10 +1,6 @@
 # Vai matar o pacman
-PASSO 1
-POS 1 1
-C
-S
-T 3
+PASSO 0
+POS 3 4
 W
 W
 W
-W
\ No newline at end of file
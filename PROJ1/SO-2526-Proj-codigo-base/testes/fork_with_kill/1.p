@@ -1,10 +1,6 @@
 # Vai dar save
-PASSO 1
+PASSO 0
 POS 3 1
-A
-A
 G
 S
 S
-S
-S
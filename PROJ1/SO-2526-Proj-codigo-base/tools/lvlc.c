@@ -0,0 +1,80 @@
+#include "board.h"
+#include "file_manager.h"
+#include "lvlb.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+//compiles one text level, its .p and .m files are read from level_dir
+static int compile_level(board_t *board, char *level_dir, char *file, char *out_dir) {
+    char path[2 * MAX_FILENAME];
+    snprintf(path, sizeof(path), "%s/%s", level_dir, file);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    snprintf(board->level_name, sizeof(board->level_name), "%s", file);
+    board->seed = 0;
+    int loaded = load_level(board, 0, fd, level_dir);
+    close(fd);
+    if (loaded == -1) {
+        fprintf(stderr, "lvlc: could not load %s\n", path);
+        unload_level(board);
+        return -1;
+    }
+
+    char out_path[3 * MAX_FILENAME];
+    size_t stem = strlen(file) - strlen(".lvl");
+    snprintf(out_path, sizeof(out_path), "%s/%.*s%s", out_dir, (int)stem, file, LVLB_EXTENSION);
+    int out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        perror(out_path);
+        unload_level(board);
+        return -1;
+    }
+    int written = lvlb_write(board, out);
+    close(out);
+    unload_level(board);
+    if (written == 0) {
+        printf("%s -> %s\n", path, out_path);
+    }
+    return written;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        printf("Usage: %s <level_directory> <output_directory>\n", argv[0]);
+        return 1;
+    }
+    char *level_dir = argv[1];
+    char *out_dir = argv[2];
+    if (mkdir(out_dir, 0755) == -1 && errno != EEXIST) {
+        perror(out_dir);
+        return 1;
+    }
+    int count;
+    char **lvl_files = get_lvl_files(level_dir, &count);
+    if (lvl_files == NULL) {
+        return 1;
+    }
+
+    open_debug_file("/dev/null");
+    board_t board;
+    arena_init(&board.arena, ARENA_BLOCK_SIZE);
+    int ret = 0;
+    for (int i = 0; i < count && ret == 0; i++) {
+        //already compiled levels are left alone
+        if (is_lvlb_file(lvl_files[i])) continue;
+        if (compile_level(&board, level_dir, lvl_files[i], out_dir) == -1) {
+            ret = 1;
+        }
+    }
+    arena_release(&board.arena);
+    close_debug_file();
+    free_lvl_files(lvl_files, count);
+    return ret;
+}
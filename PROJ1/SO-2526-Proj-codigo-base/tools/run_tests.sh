@@ -0,0 +1,77 @@
+#!/bin/sh
+# Runs every level directory of testes/ headless, one process per test and as many at once as there are cores,
+# and compares the outcome line, the quicksaves taken and restored and the boards printed at the end of each level
+# with testes/<test>/expected.
+# usage: tools/run_tests.sh [--update] [test ...]
+#   --update    writes the expected files from this run instead of comparing
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BIN=${BIN:-$ROOT/bin/Pacmanist}
+TESTS_DIR=${TESTS_DIR:-$ROOT/testes}
+SEED=${SEED:-1}
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4)}
+
+now_ms() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+# one test, run by the xargs workers below, prints a single PASS/FAIL line
+if [ "$1" = "--one" ]; then
+    mode=$2
+    name=$3
+    dir=$TESTS_DIR/$name
+    # every run gets its own directory, the game writes debug.log where it runs
+    work=$(mktemp -d "${TMPDIR:-/tmp}/pacman_test.XXXXXX") || exit 1
+    start=$(now_ms)
+    (cd "$work" && "$BIN" --headless --seed "$SEED" "$dir" > stdout 2> stderr)
+    status=$?
+    elapsed=$(($(now_ms) - start))
+    {
+        echo "exit=$status"
+        grep '^outcome=' "$work/stdout"
+        grep '^SNAPSHOT ' "$work/debug.log" 2> /dev/null
+        # the boards without the LEVEL INFO header, which holds the pid
+        sed -n '/^=== BOARD ===$/,/^==================$/p' "$work/debug.log" 2> /dev/null
+    } > "$work/actual"
+
+    if [ "$mode" = update ]; then
+        cp "$work/actual" "$dir/expected"
+        printf 'UPDATE %-30s %6d ms\n' "$name" "$elapsed"
+        result=0
+    elif [ ! -f "$dir/expected" ]; then
+        printf 'FAIL   %-30s %6d ms  no expected file, run with --update\n' "$name" "$elapsed"
+        result=1
+    elif diff -u "$dir/expected" "$work/actual" > "$work/diff"; then
+        printf 'PASS   %-30s %6d ms\n' "$name" "$elapsed"
+        result=0
+    else
+        # one write, lines of different tests never interleave
+        report=$(printf 'FAIL   %-30s %6d ms\n' "$name" "$elapsed"; sed 's/^/    /' "$work/diff")
+        echo "$report"
+        result=1
+    fi
+    rm -rf "$work"
+    exit $result
+fi
+
+mode=compare
+if [ "$1" = "--update" ]; then
+    mode=update
+    shift
+fi
+if [ ! -x "$BIN" ]; then
+    echo "run_tests: $BIN not found, run make first" >&2
+    exit 2
+fi
+if [ $# -eq 0 ]; then
+    set -- $(cd "$TESTS_DIR" && for d in */; do echo "${d%/}"; done)
+fi
+
+start=$(now_ms)
+results=$(printf '%s\n' "$@" | xargs -P "$JOBS" -I {} sh "$0" --one "$mode" {})
+echo "$results"
+total=$#
+failed=$(echo "$results" | grep -c '^FAIL')
+[ "$mode" = update ] && verb=updated || verb=passed
+echo "$((total - failed))/$total $verb in $(($(now_ms) - start)) ms ($JOBS jobs)"
+[ "$failed" -eq 0 ]